@@ -0,0 +1,59 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+#include <LoraSx1262.h>
+#include <LoraTdma.h>
+
+/************************
+* TIME-SLOTTED NETWORK
+*************************
+* When lots of radios transmit whenever they want, their packets run into eachother.
+* LoraTdma gives every radio its own time slot instead.  One radio is the coordinator (slot 0),
+* which sends a beacon every frame so everyone else knows when their slot is.
+*
+* Upload this to every radio, with a different MY_SLOT on each one.
+* ALL RADIOS MUST HAVE MATCHING SLOT_COUNT, MAX_PAYLOAD and radio configs
+*/
+#define MY_SLOT      0    //0 = coordinator.  1 to SLOT_COUNT-1 for everyone else
+#define SLOT_COUNT   8    //Coordinator + 7 other radios
+#define MAX_PAYLOAD  16   //Largest packet we'll send.  Slots are sized to fit this
+
+LoraSx1262 radio;
+LoraTdma tdma;
+byte payload[MAX_PAYLOAD] = "Hello from slot";
+byte receiveBuff[255];
+uint32_t lastSend = 0;
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("Booted");
+
+  if (!radio.begin()) { //Initialize radio
+    Serial.println("Failed to initialize radio.");
+  }
+
+  if (!tdma.begin(&radio, SLOT_COUNT, MY_SLOT, MAX_PAYLOAD)) {
+    Serial.println("Invalid TDMA settings");
+  }
+
+  Serial.print("Frame length (us): ");
+  Serial.println(tdma.frameMicros);
+}
+
+void loop() {
+  //Queue a packet every few seconds.  It goes out in our next slot
+  if (MY_SLOT != TDMA_COORDINATOR && tdma.isSynced() && millis() - lastSend > 5000) {
+    if (tdma.send(payload, MAX_PAYLOAD)) {
+      lastSend = millis();
+    }
+  }
+
+  //Keep the schedule running.  This sends beacons/packets on time and returns anything we received
+  int bytesRead = tdma.poll(receiveBuff, sizeof(receiveBuff));
+  if (bytesRead > -1) {
+    Serial.print("Received from slot ");
+    Serial.print(tdma.lastSourceSlot);
+    Serial.print(": ");
+    Serial.write(receiveBuff, bytesRead);
+    Serial.println();
+  }
+}
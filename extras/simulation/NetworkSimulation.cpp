@@ -0,0 +1,215 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* How does a network of sensors sending to one gateway hold up as it grows?
+*
+* Sensors are spread randomly over a circle with the gateway in the middle, and send a packet whenever they have one (ALOHA).
+* The channel has path loss, capture effect, collisions and (imperfect) spreading factor orthogonality.  See SimRadio.h.
+*
+* Two ways of picking the spreading factor are compared, on the same sensor layout:
+* - SF7:   Every sensor uses the default preset.  Far away sensors might not be heard at all
+* - Mixed: Every sensor uses the lowest spreading factor that reaches the gateway (like LoRaWAN's ADR).
+*          The gateway has one radio per spreading factor, all in the same place, since an SX1262 can only listen to one at a time
+*
+* For each, it reports throughput, packet delivery ratio and latency (packet created -> gateway received it).
+* The channel and traffic settings are below.  See README.md in this folder for how to build and run it.
+*/
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include "SimKernel.h"
+#include "LoraSx1262.h"
+
+//Traffic
+#define PAYLOAD_LEN         16
+#define PACKET_INTERVAL_MS  30000         //Average time between packets, per sensor
+#define WARMUP_MICROS       10000000ULL   //Ignore packets created while nodes boot
+#define MEASURE_MICROS      300000000ULL  //Count packets created during this long
+#define DRAIN_MICROS        20000000ULL   //Extra time for the last packets to get through
+
+//Layout and channel
+#define AREA_RADIUS_M       12000         //Sensors are placed randomly up to this far from the gateway
+#define LINK_MARGIN_DB      3             //Mixed mode picks the lowest SF that reaches the gateway with this much SNR to spare
+#define PATH_LOSS_EXPONENT  2.7
+#define CAPTURE_DB          6
+#define SF_REJECTION_DB     16
+
+struct Stats {
+  uint32_t created = 0;     //Packets created by the sensors
+  uint32_t delivered = 0;   //Packets the gateway received
+  std::vector<uint32_t> latencies;
+  std::set<std::pair<int, int> > seen;
+};
+static Stats stats;
+
+static bool measuring(uint64_t createdAt) {
+  return createdAt >= WARMUP_MICROS && createdAt < WARMUP_MICROS + MEASURE_MICROS;
+}
+
+//Random exponential gap, so packets arrive like a Poisson process
+static uint32_t nextGap() {
+  double uniform = (random(1, 1000000)) / 1000000.0;
+  return (uint32_t)(-log(uniform) * PACKET_INTERVAL_MS * 1000);
+}
+
+//Payload: node id, sequence number, and creation time
+static void fillPayload(byte* payload, int id, int seq, uint32_t createdAt) {
+  memset(payload, 0, PAYLOAD_LEN);
+  payload[0] = id; payload[1] = id >> 8;
+  payload[2] = seq; payload[3] = seq >> 8;
+  memcpy(&payload[4], &createdAt, 4);
+}
+
+static void recordDelivery(byte* payload, int len, uint32_t receivedAt) {
+  if (len < PAYLOAD_LEN) { return; }
+  int id = payload[0] | (payload[1] << 8);
+  int seq = payload[2] | (payload[3] << 8);
+  uint32_t createdAt;
+  memcpy(&createdAt, &payload[4], 4);
+  if (!measuring(createdAt)) { return; }
+  if (stats.seen.insert(std::make_pair(id, seq)).second) {
+    stats.delivered++;
+    stats.latencies.push_back(receivedAt - createdAt);
+  }
+}
+
+struct Node {
+  LoraSx1262 radio;
+  int id;
+  int spreadingFactor;
+  uint16_t seq = 0;
+  uint32_t nextPacket = 0;
+  byte payload[PAYLOAD_LEN];
+  byte receiveBuff[255];
+};
+
+static Node* addGateway(std::vector<Node*>& nodes, int spreadingFactor) {
+  Node* node = new Node();
+  node->id = nodes.size();
+  node->spreadingFactor = spreadingFactor;
+  nodes.push_back(node);
+
+  //Listen forever
+  SimKernel::addNode([node] { node->radio.begin(); node->radio.configSetSpreadingFactor(node->spreadingFactor); },
+                     [node] {
+                       int len = node->radio.lora_receive_async(node->receiveBuff, sizeof(node->receiveBuff));
+                       if (len >= 0) { recordDelivery(node->receiveBuff, len, micros()); }
+                       else { yield(); }
+                     });
+  return node;
+}
+
+static Node* addSensor(std::vector<Node*>& nodes, int spreadingFactor, double x, double y) {
+  Node* node = new Node();
+  node->id = nodes.size();
+  node->spreadingFactor = spreadingFactor;
+  nodes.push_back(node);
+
+  //Transmit each packet once it has been created.  If we're still busy sending the last one, it waits (and is late)
+  SimNode* simNode = SimKernel::addNode([node] {
+                                          node->radio.begin();
+                                          node->radio.configSetSpreadingFactor(node->spreadingFactor);
+                                          node->nextPacket = micros() + nextGap();
+                                        },
+                                        [node] {
+                                          int32_t wait = (int32_t)(node->nextPacket - micros());
+                                          if (wait > 0) { delay(wait / 1000 + 1); return; }
+
+                                          uint32_t createdAt = node->nextPacket;
+                                          node->nextPacket += nextGap();
+                                          fillPayload(node->payload, node->id, node->seq++, createdAt);
+                                          if (measuring(createdAt)) { stats.created++; }
+                                          node->radio.transmit(node->payload, PAYLOAD_LEN);
+                                        });
+  simNode->radio.x = x;
+  simNode->radio.y = y;
+  return node;
+}
+
+//Lowest spreading factor that reaches the gateway with LINK_MARGIN_DB to spare.  SF12 if nothing does
+static int pickSpreadingFactor(double distance) {
+  SimChannel& channel = SimChannel::get();
+  double pathLoss = channel.referenceLossDb + 10 * channel.pathLossExponent * log10(std::max(1.0, distance));
+  double snr = 22 - pathLoss - channel.noiseFloorDbm(0x05);  //Library transmits at 22dBm.  Default preset is 250khz
+  for (int sf = 7; sf < 12; sf++) {
+    if (snr >= channel.requiredSnrDb(sf) + LINK_MARGIN_DB) { return sf; }
+  }
+  return 12;
+}
+
+static uint32_t percentile(std::vector<uint32_t>& values, double fraction) {
+  if (values.empty()) { return 0; }
+  size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void runScenario(const char* name, int sensorCount, bool mixedSpreadingFactors) {
+  std::vector<Node*> nodes;
+  std::vector<Node*> gateways;
+  stats = Stats();
+
+  if (mixedSpreadingFactors) {
+    for (int sf = 7; sf <= 12; sf++) { gateways.push_back(addGateway(nodes, sf)); }
+  } else {
+    gateways.push_back(addGateway(nodes, 7));
+  }
+
+  //Same layout for every scenario with this many sensors
+  std::mt19937 layout(sensorCount);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  int sensorsPerSf[13] = {0};
+  for (int i = 0; i < sensorCount; i++) {
+    double distance = AREA_RADIUS_M * sqrt(uniform(layout));  //sqrt, so sensors are spread evenly over the area
+    double angle = 2 * M_PI * uniform(layout);
+    int sf = mixedSpreadingFactors ? pickSpreadingFactor(distance) : 7;
+    sensorsPerSf[sf]++;
+    addSensor(nodes, sf, distance * cos(angle), distance * sin(angle));
+  }
+
+  SimKernel::run(WARMUP_MICROS + MEASURE_MICROS + DRAIN_MICROS);
+
+  uint32_t collisions = 0, captured = 0;
+  for (size_t i = 0; i < gateways.size(); i++) {
+    collisions += SimKernel::nodes()[i]->radio.rxLost;
+    captured += SimKernel::nodes()[i]->radio.rxCaptured;
+  }
+
+  double seconds = MEASURE_MICROS / 1000000.0;
+  double throughput = stats.delivered * PAYLOAD_LEN * 8 / seconds;
+  double deliveryRatio = stats.created ? 100.0 * stats.delivered / stats.created : 0;
+  printf("%-6s %5d %8u %9u %8.1f%% %9.1f %8.1f %8.1f %8.1f %10u %9u   ",
+         name, sensorCount, stats.created, stats.delivered, deliveryRatio, throughput,
+         percentile(stats.latencies, 0.50) / 1000.0, percentile(stats.latencies, 0.95) / 1000.0,
+         percentile(stats.latencies, 0.99) / 1000.0, collisions, captured);
+  for (int sf = 7; sf <= 12; sf++) { printf(" %4d", sensorsPerSf[sf]); }
+  printf("\n");
+  fflush(stdout);
+
+  SimKernel::reset();
+  for (Node* node : nodes) { delete node; }
+}
+
+int main() {
+  SimChannel& channel = SimChannel::get();
+  channel.pathLossExponent = PATH_LOSS_EXPONENT;
+  channel.captureThresholdDb = CAPTURE_DB;
+  channel.sfRejectionDb = SF_REJECTION_DB;
+
+  int sensorCounts[] = {50, 100, 200, 400, 800};
+
+  printf("Packets: %d bytes, one every %ds per sensor (average).  Sensors up to %dm from the gateway\n",
+         PAYLOAD_LEN, PACKET_INTERVAL_MS / 1000, AREA_RADIUS_M);
+  printf("Channel: path loss exponent %.1f, capture %ddB, SF rejection %ddB\n",
+         PATH_LOSS_EXPONENT, CAPTURE_DB, SF_REJECTION_DB);
+  printf("%-6s %5s %8s %9s %9s %9s %8s %8s %8s %10s %9s    %s\n",
+         "mode", "nodes", "created", "delivered", "PDR", "bits/s", "p50 ms", "p95 ms", "p99 ms", "collisions", "captured", "sensors on SF7..SF12");
+  for (int sensorCount : sensorCounts) {
+    runScenario("SF7", sensorCount, false);
+    runScenario("Mixed", sensorCount, true);
+  }
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Compares unscheduled transmit() calls (ALOHA) against the LoraTdma slot scheduler, for growing numbers of nodes.
+*
+* Every node runs the real library against a simulated radio.  Node 0 is the gateway that everyone sends to
+* (and the TDMA coordinator).  Each node creates a 16 byte packet at random times, on average every
+* PACKET_INTERVAL_MS, and we count how many of them the gateway actually receives.
+*
+* See README.md in this folder for how to build and run it.
+*/
+#include <stdio.h>
+#include <math.h>
+#include <set>
+#include <utility>
+#include "SimKernel.h"
+#include "LoraSx1262.h"
+#include "LoraTdma.h"
+
+#define PAYLOAD_LEN         16
+#define PACKET_INTERVAL_MS  2000
+#define WARMUP_MICROS       10000000ULL   //Ignore packets created while nodes boot and sync
+#define MEASURE_MICROS      60000000ULL   //Count packets created during this long
+#define DRAIN_MICROS        10000000ULL   //Extra time for the last packets to get through
+
+struct Stats {
+  uint32_t created = 0;     //Packets created by the nodes
+  uint32_t sent = 0;        //Packets that went on air
+  uint32_t delivered = 0;   //Packets the gateway received
+  std::set<std::pair<int, int> > seen;
+};
+static Stats stats;
+
+static bool measuring(uint64_t createdAt) {
+  return createdAt >= WARMUP_MICROS && createdAt < WARMUP_MICROS + MEASURE_MICROS;
+}
+
+//Random exponential gap, so packets arrive like a Poisson process
+static uint32_t nextGap() {
+  double uniform = (random(1, 1000000)) / 1000000.0;
+  return (uint32_t)(-log(uniform) * PACKET_INTERVAL_MS * 1000);
+}
+
+//Payload: node id, sequence number, and creation time
+static void fillPayload(byte* payload, int id, int seq, uint32_t createdAt) {
+  memset(payload, 0, PAYLOAD_LEN);
+  payload[0] = id; payload[1] = id >> 8;
+  payload[2] = seq; payload[3] = seq >> 8;
+  memcpy(&payload[4], &createdAt, 4);
+}
+
+static void recordDelivery(byte* payload, int len) {
+  if (len < PAYLOAD_LEN) { return; }
+  int id = payload[0] | (payload[1] << 8);
+  int seq = payload[2] | (payload[3] << 8);
+  uint32_t createdAt;
+  memcpy(&createdAt, &payload[4], 4);
+  if (!measuring(createdAt)) { return; }
+  if (stats.seen.insert(std::make_pair(id, seq)).second) { stats.delivered++; }
+}
+
+struct Node {
+  LoraSx1262 radio;
+  LoraTdma tdma;
+  int id;
+  uint16_t seq = 0;
+  uint32_t nextPacket = 0;
+  byte payload[PAYLOAD_LEN];
+  byte receiveBuff[255];
+};
+
+static void addAlohaNetwork(std::vector<Node*>& nodes, int nodeCount) {
+  for (int i = 0; i <= nodeCount; i++) {
+    Node* node = new Node();
+    node->id = i;
+    nodes.push_back(node);
+
+    if (i == 0) {
+      //Gateway: listen forever
+      SimKernel::addNode([node] { node->radio.begin(); },
+                         [node] {
+                           int len = node->radio.lora_receive_async(node->receiveBuff, sizeof(node->receiveBuff));
+                           if (len >= 0) { recordDelivery(node->receiveBuff, len); }
+                           else { yield(); }
+                         });
+      continue;
+    }
+
+    //Sensor: transmit as soon as a packet is created
+    SimKernel::addNode([node] { node->radio.begin(); node->nextPacket = micros() + nextGap(); },
+                       [node] {
+                         int32_t wait = (int32_t)(node->nextPacket - micros());
+                         if (wait > 0) { delay(wait / 1000 + 1); return; }
+
+                         uint32_t createdAt = node->nextPacket;
+                         node->nextPacket += nextGap();
+                         fillPayload(node->payload, node->id, node->seq++, createdAt);
+                         if (measuring(createdAt)) { stats.created++; stats.sent++; }
+                         node->radio.transmit(node->payload, PAYLOAD_LEN);
+                       });
+  }
+}
+
+static void addTdmaNetwork(std::vector<Node*>& nodes, int nodeCount) {
+  for (int i = 0; i <= nodeCount; i++) {
+    Node* node = new Node();
+    node->id = i;
+    nodes.push_back(node);
+
+    if (i == 0) {
+      //Gateway is the coordinator: sends beacons, and receives everyone else's packets
+      SimKernel::addNode([node, nodeCount] { node->radio.begin(); node->tdma.begin(&node->radio, nodeCount + 1, TDMA_COORDINATOR, PAYLOAD_LEN); },
+                         [node] {
+                           int len = node->tdma.poll(node->receiveBuff, sizeof(node->receiveBuff));
+                           if (len >= 0) { recordDelivery(node->receiveBuff, len); }
+                           else { SimKernel::sleepUntilIrq(node->tdma.idleMicros()); }
+                         });
+      continue;
+    }
+
+    //Sensor: queue packets for our slot.  If the last packet is still waiting, the new one is dropped
+    SimKernel::addNode([node, nodeCount] {
+                         node->radio.begin();
+                         node->tdma.begin(&node->radio, nodeCount + 1, node->id, PAYLOAD_LEN);
+                         node->nextPacket = micros() + nextGap();
+                       },
+                       [node] {
+                         if ((int32_t)(micros() - node->nextPacket) >= 0) {
+                           uint32_t createdAt = node->nextPacket;
+                           node->nextPacket += nextGap();
+                           if (measuring(createdAt)) { stats.created++; }
+                           if (!node->tdma.sendPending()) {
+                             fillPayload(node->payload, node->id, node->seq++, createdAt);
+                             node->tdma.send(node->payload, PAYLOAD_LEN);
+                             if (measuring(createdAt)) { stats.sent++; }
+                           }
+                         }
+
+                         int len = node->tdma.poll(node->receiveBuff, sizeof(node->receiveBuff));
+                         if (len < 0) {
+                           uint32_t untilPacket = node->nextPacket - micros();
+                           SimKernel::sleepUntilIrq(std::min(node->tdma.idleMicros(), untilPacket));
+                         }
+                       });
+  }
+}
+
+static void runScenario(const char* name, int nodeCount, bool tdma) {
+  std::vector<Node*> nodes;
+  stats = Stats();
+  if (tdma) { addTdmaNetwork(nodes, nodeCount); }
+  else      { addAlohaNetwork(nodes, nodeCount); }
+
+  SimKernel::run(WARMUP_MICROS + MEASURE_MICROS + DRAIN_MICROS);
+
+  double seconds = MEASURE_MICROS / 1000000.0;
+  double throughput = stats.delivered * PAYLOAD_LEN * 8 / seconds;
+  double deliveryRatio = stats.created ? 100.0 * stats.delivered / stats.created : 0;
+  double lostOnAir = stats.sent ? 100.0 * (stats.sent - stats.delivered) / stats.sent : 0;
+  uint32_t collisions = SimKernel::nodes()[0]->radio.rxLost;
+
+  printf("%-6s %5d %8u %8u %9u %10.1f %9.1f%% %9.1f%% %10u\n",
+         name, nodeCount, stats.created, stats.sent, stats.delivered, throughput, deliveryRatio, lostOnAir, collisions);
+
+  SimKernel::reset();
+  for (Node* node : nodes) { delete node; }
+}
+
+int main() {
+  int nodeCounts[] = {10, 25, 50, 100};
+
+  printf("Packets: %d bytes, one every %dms per node (average).  Radio: default preset (SF7, 250khz, CR4/5)\n",
+         PAYLOAD_LEN, PACKET_INTERVAL_MS);
+  printf("%-6s %5s %8s %8s %9s %10s %10s %10s %10s\n",
+         "mode", "nodes", "created", "sent", "delivered", "bits/s", "delivered", "lost", "collisions");
+  for (int nodeCount : nodeCounts) {
+    runScenario("ALOHA", nodeCount, false);
+    runScenario("TDMA", nodeCount, true);
+  }
+  return 0;
+}
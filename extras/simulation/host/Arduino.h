@@ -0,0 +1,62 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Host (Linux) stand-in for the Arduino core, used by the network simulations.
+* Just enough of the Arduino API for the library to compile unchanged.
+* Every call runs against the simulated node (and radio) that owns the calling thread. See SimKernel.h
+*/
+#ifndef __SIM_ARDUINO__
+#define __SIM_ARDUINO__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+#define RISING  3
+#define HEX     16
+#define DEC     10
+
+#define A0      14
+
+//Pins can't raise interrupts in the simulation.  The library falls back to polling DIO1
+#define NOT_AN_INTERRUPT -1
+inline int digitalPinToInterrupt(int pin) { (void)pin; return NOT_AN_INTERRUPT; }
+inline void attachInterrupt(int interrupt, void (*isr)(), int mode) { (void)interrupt; (void)isr; (void)mode; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+//Time is simulated.  Each node has its own virtual clock, starting at 0 when the simulation starts
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();   //Sleeps until DIO1 goes high (capped at 1 second), like an MCU waiting on the radio interrupt
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+//Serial output is thrown away, so hundreds of nodes don't flood the console
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t print(const char* s) { (void)s; return 0; }
+    size_t print(long n, int base = DEC) { (void)n; (void)base; return 0; }
+    size_t println() { return 0; }
+    size_t println(const char* s) { (void)s; return 0; }
+    size_t println(long n, int base = DEC) { (void)n; (void)base; return 0; }
+    size_t write(const uint8_t* buff, size_t len) { (void)buff; return len; }
+};
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,31 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Host (Linux) stand-in for the Arduino SPI library.
+* Bytes go straight to the simulated radio of the node that owns the calling thread.
+*/
+#ifndef __SIM_SPI__
+#define __SIM_SPI__
+
+#include "Arduino.h"
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+class SPISettings {
+  public:
+    SPISettings(uint32_t clock, int bitOrder, int dataMode) { (void)clock; (void)bitOrder; (void)dataMode; }
+};
+
+class SPIClass {
+  public:
+    void begin() {}
+    void beginTransaction(SPISettings settings) { (void)settings; }
+    void endTransaction() {}
+    uint8_t transfer(uint8_t data);
+    uint16_t transfer16(uint16_t data);
+    void transfer(void* buff, size_t count);
+};
+extern SPIClass SPI;
+
+#endif
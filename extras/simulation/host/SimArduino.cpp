@@ -0,0 +1,96 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Arduino core + SPI functions for the simulation.  Everything is routed to the calling node's clock and radio */
+#include "Arduino.h"
+#include "SPI.h"
+#include "SimKernel.h"
+#include "LoraSx1262.h"   //For the pin assignments
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+//Virtual time spent by a few common operations
+#define POLL_COST_MICROS      1   //Reading a pin or the clock.  Stops busy-wait loops from freezing time
+#define SPI_BYTE_MICROS       2   //4MHz SPI clock
+#define YIELD_LIMIT_MICROS    1000000
+
+void pinMode(int pin, int mode) { (void)pin; (void)mode; }
+
+void digitalWrite(int pin, int value) {
+  SimNode* node = SimKernel::self();
+  node->radio.update(node->now);
+
+  if (pin == SX1262_NSS) {
+    if (value == LOW) {
+      node->radio.select();
+    } else {
+      node->radio.deselect();
+      SimKernel::channelChanged();   //Command might have started a transmission
+      SimKernel::advance(node->radio.spiBytes * SPI_BYTE_MICROS);
+    }
+  } else if (pin == SX1262_RESET && value == LOW) {
+    node->radio.reset();
+  }
+}
+
+int digitalRead(int pin) {
+  SimNode* node = SimKernel::self();
+  node->radio.update(node->now);
+  int value = (pin == SX1262_DIO1) ? node->radio.dio1() : LOW;
+  SimKernel::advance(POLL_COST_MICROS);
+  return value;
+}
+
+unsigned long micros() {
+  SimKernel::advance(POLL_COST_MICROS);
+  return (unsigned long)(uint32_t)SimKernel::self()->now;   //Wraps every ~71 minutes, just like the real thing
+}
+
+unsigned long millis() {
+  SimKernel::advance(POLL_COST_MICROS);
+  return (unsigned long)(uint32_t)(SimKernel::self()->now / 1000);
+}
+
+void delay(unsigned long ms) {
+  SimKernel::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  SimKernel::advance(us);
+}
+
+void yield() {
+  SimKernel::sleepUntilIrq(YIELD_LIMIT_MICROS);
+}
+
+long random(long howBig) {
+  if (howBig <= 0) { return 0; }
+  return SimKernel::self()->rng() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) { return howSmall; }
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  SimKernel::self()->rng.seed(seed);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  SimNode* node = SimKernel::self();
+  node->radio.update(node->now);
+  return node->radio.transfer(data);
+}
+
+uint16_t SPIClass::transfer16(uint16_t data) {
+  uint16_t msb = transfer(data >> 8);
+  uint16_t lsb = transfer(data & 0xFF);
+  return (msb << 8) | lsb;
+}
+
+void SPIClass::transfer(void* buff, size_t count) {
+  uint8_t* bytes = (uint8_t*)buff;
+  for (size_t i = 0; i < count; i++) { bytes[i] = transfer(bytes[i]); }
+}
@@ -0,0 +1,150 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+#include "SimKernel.h"
+#include <algorithm>
+#include <mutex>
+
+//Thrown inside a node's thread to unwind it once the simulation is over
+struct SimEnded {};
+
+static std::vector<std::unique_ptr<SimNode>> allNodes;
+static std::mutex lock;
+static SimNode* current = NULL;    //The one node that is allowed to run
+static bool ended = false;
+static uint64_t endTime = 0;
+static thread_local SimNode* selfNode = NULL;
+
+//When a node next needs to run
+static uint64_t wakeTime(SimNode* node) {
+  if (!node->waiting) { return node->now; }
+  return std::max(node->now, std::min(node->wakeLimit, node->radio.nextEventTime()));
+}
+
+//Earliest wake time of every node except this one
+static uint64_t minOtherWakeTime(SimNode* me) {
+  uint64_t earliest = SIM_FOREVER;
+  for (auto& node : allNodes) {
+    if (node.get() != me) { earliest = std::min(earliest, wakeTime(node.get())); }
+  }
+  return earliest;
+}
+
+//Hand the baton to whichever node is furthest behind (which might be us), and wait until it comes back
+static void reschedule() {
+  SimNode* me = selfNode;
+  std::unique_lock<std::mutex> guard(lock);
+
+  SimNode* next = me;
+  uint64_t nextTime = wakeTime(me);
+  for (auto& node : allNodes) {
+    uint64_t t = wakeTime(node.get());
+    if (t < nextTime) { next = node.get(); nextTime = t; }
+  }
+
+  if (nextTime >= endTime) {
+    ended = true;
+    for (auto& node : allNodes) { node->baton.notify_one(); }
+    throw SimEnded();
+  }
+
+  if (next->waiting) { next->now = nextTime; }
+  if (next != me) {
+    current = next;
+    next->baton.notify_one();
+    me->baton.wait(guard, [&] { return current == me || ended; });
+    if (ended) { throw SimEnded(); }
+  }
+  me->minOther = minOtherWakeTime(me);
+}
+
+static void nodeThread(SimNode* node) {
+  selfNode = node;
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    node->baton.wait(guard, [&] { return current == node || ended; });
+    if (ended) { return; }
+    node->minOther = minOtherWakeTime(node);
+  }
+
+  try {
+    node->setup();
+    for (;;) { node->loop(); }
+  } catch (SimEnded&) {
+    //Simulation is over
+  }
+}
+
+SimNode* SimKernel::addNode(std::function<void()> setup, std::function<void()> loop) {
+  allNodes.emplace_back(new SimNode(allNodes.size()));
+  SimNode* node = allNodes.back().get();
+  node->setup = setup;
+  node->loop = loop;
+  SimChannel::get().addRadio(&node->radio);
+  return node;
+}
+
+void SimKernel::run(uint64_t durationMicros) {
+  endTime = durationMicros;
+  ended = false;
+  current = NULL;
+  for (auto& node : allNodes) {
+    node->thread = std::thread(nodeThread, node.get());
+  }
+
+  //Everyone starts at time 0, so just start with the first node
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    current = allNodes.empty() ? NULL : allNodes.front().get();
+    if (current) { current->baton.notify_one(); }
+  }
+  for (auto& node : allNodes) {
+    node->thread.join();
+  }
+}
+
+void SimKernel::reset() {
+  allNodes.clear();
+  SimChannel::get().clear();
+}
+
+SimNode* SimKernel::self() {
+  return selfNode;
+}
+
+std::vector<std::unique_ptr<SimNode>>& SimKernel::nodes() {
+  return allNodes;
+}
+
+void SimKernel::advance(uint64_t micros) {
+  SimNode* me = selfNode;
+  me->now += micros;
+  if (me->now > me->minOther) { reschedule(); }
+}
+
+void SimKernel::sleepUntilIrq(uint64_t maxMicros) {
+  SimNode* me = selfNode;
+  me->radio.update(me->now);
+  if (me->radio.dio1()) { return; }
+
+  me->waiting = true;
+  me->wakeLimit = (maxMicros == SIM_FOREVER) ? SIM_FOREVER : me->now + maxMicros;
+  try {
+    //We get woken for every radio event, not all of which raise DIO1.  Keep sleeping until one does
+    do {
+      reschedule();
+      me->radio.update(me->now);
+    } while (!me->radio.dio1() && me->now < me->wakeLimit);
+  } catch (SimEnded&) {
+    me->waiting = false;
+    throw;
+  }
+  me->waiting = false;
+  me->minOther = minOtherWakeTime(me);
+}
+
+void SimKernel::channelChanged() {
+  SimNode* me = selfNode;
+  std::unique_lock<std::mutex> guard(lock);
+  me->minOther = minOtherWakeTime(me);
+}
@@ -0,0 +1,59 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Virtual-time kernel for running many Arduino "sketches" (nodes) in one Linux process.
+*
+* Every node runs its setup()/loop() on its own thread, with its own virtual clock and its own simulated radio.
+* Only one node runs at a time: always the one that is furthest behind in virtual time.
+* That way, when a node does something at time T (like start a transmission), every other node is already at T or later,
+* and the radio channel sees events in the right order.  Runs are fully deterministic.
+*
+* Virtual time only moves when a node spends it: delay(), SPI traffic, or a small cost for polling millis()/micros()/pins.
+* A node can also sleep until its radio raises DIO1 (see sleepUntilIrq()), like an MCU sleeping on the radio interrupt.
+*/
+#ifndef __SIM_KERNEL__
+#define __SIM_KERNEL__
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "SimRadio.h"
+
+#define SIM_FOREVER UINT64_MAX
+
+struct SimNode {
+  SimNode(int id) : id(id), radio(this), rng(id + 1) {}
+
+  int id;
+  uint64_t now = 0;               //This node's virtual time, in microseconds
+  bool waiting = false;           //Sleeping until DIO1 goes high (or wakeLimit)
+  uint64_t wakeLimit = 0;
+  uint64_t minOther = 0;          //Earliest time any other node needs to run.  We can keep going until we pass it
+  SimRadio radio;
+  std::mt19937 rng;
+  std::function<void()> setup;
+  std::function<void()> loop;
+  std::thread thread;
+  std::condition_variable baton;  //Signalled when it's this node's turn to run
+};
+
+class SimKernel {
+  public:
+    static SimNode* addNode(std::function<void()> setup, std::function<void()> loop);
+    static void run(uint64_t durationMicros);   //Runs every node until virtual time reaches durationMicros
+    static void reset();                        //Removes all nodes, so another run can be set up
+
+    //These are for use from inside a node's setup()/loop()
+    static SimNode* self();
+    static void advance(uint64_t micros);       //Spend virtual time
+    static void sleepUntilIrq(uint64_t maxMicros); //Sleep until our radio's DIO1 is high, or maxMicros passes
+    static void channelChanged();               //Call after touching the shared channel, so other nodes get a chance to react
+
+    static std::vector<std::unique_ptr<SimNode>>& nodes();
+};
+
+#endif
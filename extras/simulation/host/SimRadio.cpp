@@ -0,0 +1,347 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+#include "SimRadio.h"
+#include "SimKernel.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+//IRQ bits (datasheet table 13-29)
+#define IRQ_TX_DONE  0x0001
+#define IRQ_RX_DONE  0x0002
+#define IRQ_TIMEOUT  0x0200
+
+//Keep packets around this long after they end, so late overlap checks still see them
+#define HISTORY_MICROS 300000000ULL
+
+static double bandwidthHz(uint8_t bandwidth) {
+  switch (bandwidth) {
+    case 0x00: return   7810;
+    case 0x08: return  10420;
+    case 0x01: return  15630;
+    case 0x09: return  20830;
+    case 0x02: return  31250;
+    case 0x0A: return  41670;
+    case 0x03: return  62500;
+    case 0x04: return 125000;
+    case 0x05: return 250000;
+    default:   return 500000;
+  }
+}
+
+SimRadio::SimRadio(SimNode* node) : node(node) {
+  reset();
+}
+
+void SimRadio::reset() {
+  mode = MODE_STBY_RC;
+  command.clear();
+  memset(buffer, 0, sizeof(buffer));
+  registers.clear();
+  registers[0x0740] = 0x14;   //LoRa sync word MSB (private network default)
+  registers[0x0741] = 0x24;   //LoRa sync word LSB
+  irqStatus = 0;
+  irqMask = 0;
+  dio1Mask = 0;
+  symbolTimeout = 0;
+  if (transmitting) { transmitting->aborted = true; transmitting->end = node->now; }
+  transmitting.reset();
+  locked.reset();
+  rxTimeoutAt = SIM_FOREVER;
+}
+
+void SimRadio::select() {
+  command.clear();
+  spiBytes = 0;
+}
+
+void SimRadio::deselect() {
+  if (!command.empty()) { execute(); }
+  command.clear();
+}
+
+bool SimRadio::dio1() {
+  return (irqStatus & dio1Mask) != 0;
+}
+
+//Status byte returned by every command (datasheet 13.5.1)
+uint8_t SimRadio::status() {
+  uint8_t commandStatus = 0x1;
+  if (mode == MODE_RX && (irqStatus & IRQ_RX_DONE)) { commandStatus = 0x2; }  //Data available to host
+  return (mode << 4) | (commandStatus << 1);
+}
+
+void SimRadio::raiseIrq(uint16_t bit) {
+  if (irqMask & bit) { irqStatus |= bit; }
+}
+
+//Respond to one byte of an SPI command.  Reads have to answer while the command is still being clocked in
+uint8_t SimRadio::transfer(uint8_t data) {
+  command.push_back(data);
+  spiBytes++;
+  size_t index = command.size() - 1;
+  if (index == 0) { return status(); }
+
+  switch (command[0]) {
+    case 0x12:  //GetIrqStatus
+      if (index == 2) { return irqStatus >> 8; }
+      if (index == 3) { return irqStatus & 0xFF; }
+      break;
+    case 0x13:  //GetRxBufferStatus
+      if (index == 2) { return rxLen; }
+      if (index == 3) { return 0x00; }  //Packets always start at offset 0
+      break;
+    case 0x14: {  //GetPacketStatus
+      uint8_t rssi = (uint8_t)std::min(255.0, std::max(0.0, -rxRssi * 2));
+      if (index == 2) { return rssi; }                                                //RssiPkt = -value/2 dBm
+      if (index == 3) { return (uint8_t)(int8_t)std::min(127.0, std::max(-128.0, rxSnr * 4)); }  //SnrPkt = value/4 dB
+      if (index == 4) { return rssi; }                                                //SignalRssiPkt
+      break;
+    }
+    case 0x1E:  //ReadBuffer: offset, status, data...
+      if (index >= 3) { return buffer[(uint8_t)(command[1] + index - 3)]; }
+      break;
+    case 0x1D:  //ReadRegister: address MSB, address LSB, status, data...
+      if (index >= 4) {
+        uint16_t address = ((command[1] << 8) | command[2]) + (index - 4);
+        return registers.count(address) ? registers[address] : 0x00;
+      }
+      break;
+  }
+  return status();
+}
+
+//Run a command once chip-select goes high
+void SimRadio::execute() {
+  uint64_t now = node->now;
+  switch (command[0]) {
+    case 0x80:  //SetStandby
+      if (transmitting) { transmitting->aborted = true; transmitting->end = now; transmitting.reset(); }
+      locked.reset();
+      mode = (command.size() > 1 && command[1]) ? MODE_STBY_XOSC : MODE_STBY_RC;
+      break;
+
+    case 0x82: {  //SetRx
+      if (command.size() < 4) { break; }
+      uint32_t steps = (command[1] << 16) | (command[2] << 8) | command[3];
+      mode = MODE_RX;
+      locked.reset();
+      rxContinuous = (steps == 0xFFFFFF);
+      rxTimeoutAt = (steps == 0 || rxContinuous) ? SIM_FOREVER : now + (uint64_t)(steps * 15.625);
+      if (!rxContinuous && symbolTimeout > 0) {
+        rxTimeoutAt = std::min(rxTimeoutAt, now + symbolTimeout * symbolMicros());
+      }
+      break;
+    }
+
+    case 0x83: {  //SetTx
+      SimTransmissionPtr tx(new SimTransmission());
+      tx->sender = this;
+      tx->start = now;
+      tx->end = now + timeOnAir(payloadLen);
+      tx->pllFrequency = pllFrequency;
+      tx->spreadingFactor = spreadingFactor;
+      tx->bandwidth = bandwidth;
+      tx->syncWord = syncWord();
+      tx->txPowerDbm = txPowerDbm;
+      tx->payload.assign(buffer, buffer + payloadLen);
+      locked.reset();
+      mode = MODE_TX;
+      transmitting = tx;
+      txEnd = tx->end;
+      txPackets++;
+      SimChannel::get().startTransmission(tx);
+      break;
+    }
+
+    case 0x86:  //SetRfFrequency
+      if (command.size() < 5) { break; }
+      pllFrequency = ((uint32_t)command[1] << 24) | (command[2] << 16) | (command[3] << 8) | command[4];
+      break;
+
+    case 0x8B:  //SetModulationParams
+      if (command.size() < 5) { break; }
+      spreadingFactor = command[1];
+      bandwidth = command[2];
+      codingRate = command[3];
+      lowDataRateOptimize = command[4];
+      break;
+
+    case 0x8C:  //SetPacketParams
+      if (command.size() < 6) { break; }
+      preambleLen = (command[1] << 8) | command[2];
+      implicitHeader = command[3];
+      payloadLen = command[4];
+      crcOn = command[5];
+      break;
+
+    case 0x0E:  //WriteBuffer: offset, data...
+      for (size_t i = 2; i < command.size(); i++) { buffer[(uint8_t)(command[1] + i - 2)] = command[i]; }
+      break;
+
+    case 0x0D: {  //WriteRegister: address MSB, address LSB, data...
+      uint16_t address = (command[1] << 8) | command[2];
+      for (size_t i = 3; i < command.size(); i++) { registers[address + i - 3] = command[i]; }
+      break;
+    }
+
+    case 0x8E:  //SetTxParams: power, ramp time
+      if (command.size() > 1) { txPowerDbm = (int8_t)command[1]; }
+      break;
+
+    case 0x08:  //SetDioIrqParams
+      if (command.size() < 5) { break; }
+      irqMask = (command[1] << 8) | command[2];
+      dio1Mask = (command[3] << 8) | command[4];
+      break;
+
+    case 0x02:  //ClearIrqStatus
+      if (command.size() < 3) { break; }
+      irqStatus &= ~((command[1] << 8) | command[2]);
+      break;
+
+    case 0xA0:  //SetLoRaSymbNumTimeout
+      if (command.size() > 1) { symbolTimeout = command[1]; }
+      break;
+  }
+}
+
+uint64_t SimRadio::nextEventTime() {
+  if (mode == MODE_TX) { return txEnd; }
+  if (mode == MODE_RX) { return locked ? locked->end : rxTimeoutAt; }
+  return SIM_FOREVER;
+}
+
+void SimRadio::update(uint64_t now) {
+  while (nextEventTime() <= now) {
+    if (mode == MODE_TX) {
+      transmitting.reset();
+      mode = MODE_STBY_RC;
+      raiseIrq(IRQ_TX_DONE);
+    } else if (locked) {
+      finishReception();
+    } else {
+      //Receive window closed without locking onto anything
+      mode = MODE_STBY_RC;
+      raiseIrq(IRQ_TIMEOUT);
+    }
+  }
+}
+
+void SimRadio::finishReception() {
+  SimTransmissionPtr tx = locked;
+  locked.reset();
+
+  bool captured = false;
+  if (tx->aborted || SimChannel::get().collided(*tx, this, &captured)) {
+    rxLost++;
+    return; //Keep listening.  A receive window picks up its timeout again
+  }
+  if (captured) { rxCaptured++; }
+
+  memcpy(buffer, tx->payload.data(), tx->payload.size());
+  rxLen = tx->payload.size();
+  rxPackets++;
+  raiseIrq(IRQ_RX_DONE);
+  if (!rxContinuous) { mode = MODE_STBY_RC; }
+}
+
+void SimRadio::onTransmissionStart(const SimTransmissionPtr& tx) {
+  if (mode != MODE_RX || locked) { return; }
+  if (tx->pllFrequency != pllFrequency || tx->spreadingFactor != spreadingFactor || tx->bandwidth != bandwidth) { return; }
+  if (tx->syncWord != syncWord()) { return; }  //Someone else's network.  The radio ignores it without waking anyone up
+
+  //Too weak to hear over the noise?
+  SimChannel& channel = SimChannel::get();
+  double rssi = channel.receivedPowerDbm(*tx, this);
+  double snr = rssi - channel.noiseFloorDbm(bandwidth);
+  if (snr < channel.requiredSnrDb(spreadingFactor)) { return; }
+
+  rxRssi = rssi;
+  rxSnr = snr;
+  locked = tx;  //Timer stops once we lock on (StopTimerOnPreamble), so the window can't time out mid-packet
+}
+
+uint16_t SimRadio::syncWord() {
+  return (registers[0x0740] << 8) | registers[0x0741];
+}
+
+uint64_t SimRadio::symbolMicros() {
+  return (uint64_t)((1 << spreadingFactor) * 1000000.0 / bandwidthHz(bandwidth));
+}
+
+//Datasheet section 6.1.4
+uint64_t SimRadio::timeOnAir(int len) {
+  int sf = spreadingFactor;
+  double bits = 8.0 * len + (crcOn ? 16 : 0) - 4 * sf + (implicitHeader ? 0 : 20) + ((sf >= 7) ? 8 : 0);
+  double bitsPerGroup = 4.0 * (lowDataRateOptimize ? sf - 2 : sf);
+  double symbols = preambleLen + ((sf < 7) ? 6.25 : 4.25) + 8 + ceil(std::max(bits, 0.0) / bitsPerGroup) * (codingRate + 4);
+  return (uint64_t)(symbols * (1 << sf) * 1000000.0 / bandwidthHz(bandwidth));
+}
+
+
+SimChannel& SimChannel::get() {
+  static SimChannel channel;
+  return channel;
+}
+
+void SimChannel::addRadio(SimRadio* radio) {
+  radios.push_back(radio);
+}
+
+void SimChannel::clear() {
+  radios.clear();
+  history.clear();
+  transmissions = 0;
+}
+
+void SimChannel::startTransmission(const SimTransmissionPtr& tx) {
+  transmissions++;
+  while (!history.empty() && history.front()->end + HISTORY_MICROS < tx->start) { history.pop_front(); }
+  history.push_back(tx);
+
+  //Everyone else is at tx->start or later (see SimKernel), so bring their radios up to date and let them hear it
+  for (SimRadio* radio : radios) {
+    if (radio == tx->sender) { continue; }
+    radio->update(tx->start);
+    radio->onTransmissionStart(tx);
+  }
+}
+
+//Was the packet wiped out by anything else on this frequency that overlapped it?
+//If it overlapped with something but was strong enough to survive, captured is set
+bool SimChannel::collided(const SimTransmission& tx, const SimRadio* receiver, bool* captured) {
+  double interferenceMw = 0;
+  for (auto& other : history) {
+    if (other.get() == &tx || other->sender == receiver) { continue; }
+    if (other->pllFrequency != tx.pllFrequency) { continue; }
+    if (other->start >= tx.end || other->end <= tx.start) { continue; }
+
+    double power = receivedPowerDbm(*other, receiver);
+    if (other->spreadingFactor != tx.spreadingFactor || other->bandwidth != tx.bandwidth) { power -= sfRejectionDb; }
+    interferenceMw += pow(10, power / 10);
+  }
+  if (interferenceMw == 0) { return false; }
+
+  double signalToInterference = receivedPowerDbm(tx, receiver) - 10 * log10(interferenceMw);
+  if (signalToInterference < captureThresholdDb) { return true; }
+  *captured = true;
+  return false;
+}
+
+//Log-distance path loss.  Radios closer than 1 meter are treated as 1 meter apart
+double SimChannel::receivedPowerDbm(const SimTransmission& tx, const SimRadio* receiver) {
+  double distance = std::max(1.0, hypot(tx.sender->x - receiver->x, tx.sender->y - receiver->y));
+  return tx.txPowerDbm - referenceLossDb - 10 * pathLossExponent * log10(distance);
+}
+
+//Thermal noise over the channel bandwidth, plus the receiver's own noise
+double SimChannel::noiseFloorDbm(uint8_t bandwidth) {
+  return -174 + 10 * log10(bandwidthHz(bandwidth)) + noiseFigureDb;
+}
+
+//Lowest SNR each spreading factor can demodulate (datasheet table 6-1)
+double SimChannel::requiredSnrDb(uint8_t spreadingFactor) {
+  return -2.5 * (spreadingFactor - 4);   //SF5 = -2.5dB ... SF12 = -20dB
+}
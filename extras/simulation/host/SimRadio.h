@@ -0,0 +1,138 @@
+/*License: CC 4.0 - Attribution, NonCommercial (by Mitch Davis, github.com/thekakester)
+* https://creativecommons.org/licenses/by-nc/4.0/   (See README for details)*/
+
+/* Simulated SX1262 radio, and the radio channel they all share.
+*
+* The radio understands the same SPI commands as the real chip (the subset this library uses), so the library
+* runs unchanged on top of it.  Time-on-air is calculated from whatever modulation and packet params the library sent.
+*
+* Channel model (see SimChannel for the settings):
+* - Path loss: received power falls off with distance between the radios (log-distance model).  Each radio has a position,
+*   and transmits at whatever power the library set with SetTxParams
+* - A receiver locks onto a packet if it is listening on the same frequency/SF/bandwidth/sync word when the packet starts,
+*   and the packet is strong enough to be heard over the noise at that spreading factor
+* - Collisions and capture: the packet survives anything else on the same frequency that overlaps it, as long as it is
+*   captureThresholdDb stronger than all of the overlapping packets added together
+* - SF orthogonality: overlapping packets with a different spreading factor (or bandwidth) count as sfRejectionDb weaker
+*/
+#ifndef __SIM_RADIO__
+#define __SIM_RADIO__
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+struct SimNode;
+class SimRadio;
+
+struct SimTransmission {
+  SimRadio* sender;
+  uint64_t start;
+  uint64_t end;
+  uint32_t pllFrequency;
+  uint8_t spreadingFactor;
+  uint8_t bandwidth;
+  uint16_t syncWord;      //Registers 0x0740/0x0741 when the packet was sent
+  int8_t txPowerDbm;
+  std::vector<uint8_t> payload;
+  bool aborted = false;   //Sender went to standby before the packet finished
+};
+typedef std::shared_ptr<SimTransmission> SimTransmissionPtr;
+
+class SimRadio {
+  public:
+    SimRadio(SimNode* node);
+
+    //Pin and SPI interface.  The Arduino shim calls these
+    void select();                  //NSS went low
+    void deselect();                //NSS went high.  Runs the command that was just clocked in
+    uint8_t transfer(uint8_t data);
+    bool dio1();
+    void reset();
+
+    //Time.  Events (TxDone, RxDone, Timeout) happen lazily whenever the radio is looked at
+    void update(uint64_t now);
+    uint64_t nextEventTime();       //SIM_FOREVER if nothing is scheduled
+
+    void onTransmissionStart(const SimTransmissionPtr& tx);  //Called by the channel when anyone starts transmitting
+    uint64_t timeOnAir(int payloadLen);
+
+    SimNode* node;
+    uint32_t spiBytes = 0;          //Bytes clocked in during the current chip-select
+    double x = 0, y = 0;            //Position in meters, for path loss
+
+    //Current config, as set by the library
+    uint32_t pllFrequency = 0;
+    uint8_t spreadingFactor = 7;
+    uint8_t bandwidth = 4;
+    uint8_t codingRate = 1;
+    uint8_t lowDataRateOptimize = 0;
+    uint16_t preambleLen = 12;
+    bool implicitHeader = false;
+    bool crcOn = false;
+    uint8_t payloadLen = 0;
+    int8_t txPowerDbm = 14;         //Set by SetTxParams
+
+    //Counters, for reports
+    uint32_t txPackets = 0;
+    uint32_t rxPackets = 0;         //Packets handed to the library (RxDone)
+    uint32_t rxLost = 0;            //Packets we locked onto that were lost to a collision
+    uint32_t rxCaptured = 0;        //Packets that overlapped with others, but were strong enough to get through anyway
+
+  private:
+    enum Mode { MODE_STBY_RC = 0x2, MODE_STBY_XOSC = 0x3, MODE_RX = 0x5, MODE_TX = 0x6 };
+
+    uint8_t status();
+    void raiseIrq(uint16_t bit);
+    void execute();
+    void finishReception();
+    uint64_t symbolMicros();
+    uint16_t syncWord();
+
+    Mode mode = MODE_STBY_RC;
+    std::vector<uint8_t> command;
+    uint8_t buffer[256];
+    std::map<uint16_t, uint8_t> registers;
+    uint16_t irqStatus = 0;
+    uint16_t irqMask = 0;
+    uint16_t dio1Mask = 0;
+    uint8_t symbolTimeout = 0;
+
+    SimTransmissionPtr transmitting;
+    uint64_t txEnd = 0;
+
+    bool rxContinuous = false;
+    uint64_t rxTimeoutAt = 0;       //SIM_FOREVER for no timeout
+    SimTransmissionPtr locked;      //Packet we are currently receiving
+    uint8_t rxLen = 0;
+    double rxRssi = 0;              //Signal strength and SNR of the last packet we locked onto, for GetPacketStatus
+    double rxSnr = 0;
+};
+
+class SimChannel {
+  public:
+    static SimChannel& get();
+    void addRadio(SimRadio* radio);
+    void clear();
+    void startTransmission(const SimTransmissionPtr& tx);
+    bool collided(const SimTransmission& tx, const SimRadio* receiver, bool* captured);
+
+    double receivedPowerDbm(const SimTransmission& tx, const SimRadio* receiver);
+    double noiseFloorDbm(uint8_t bandwidth);
+    double requiredSnrDb(uint8_t spreadingFactor);
+
+    std::vector<SimRadio*> radios;
+    std::deque<SimTransmissionPtr> history;  //Recent packets, for overlap checks
+    uint32_t transmissions = 0;
+
+    //Channel model.  Set these before SimKernel::run().  They are kept across clear()
+    double pathLossExponent = 2.7;    //2 = free space.  2.7-3.5 is typical for urban areas
+    double referenceLossDb = 40;      //Path loss at 1 meter (about 32dB free space at 915mhz, plus antennas/cables)
+    double noiseFigureDb = 6;         //Receiver noise figure
+    double captureThresholdDb = 6;    //How much stronger a packet has to be than everything overlapping it, to survive
+    double sfRejectionDb = 16;        //How much weaker an overlapping packet with a different SF looks.  Set very high for perfect orthogonality
+};
+
+#endif
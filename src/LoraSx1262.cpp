@@ -18,6 +18,9 @@
 #include "Arduino.h"
 #include "LoraSx1262.h"
 
+//The radio that DIO1 interrupts are routed to (see begin())
+LoraSx1262* LoraSx1262::interruptRadio = NULL;
+
 bool LoraSx1262::begin() {
   //Set up SPI to talk to the LoRa Radio shield
   SPI.begin();
@@ -33,6 +36,15 @@ bool LoraSx1262::begin() {
   
   pinMode(SX1262_DIO1, INPUT);  //Radio interrupt pin.  Goes high when we receive a packet
 
+  //If DIO1 is wired to an interrupt-capable pin, timestamp radio events the moment they happen.
+  //Otherwise timestamps are taken whenever the code notices DIO1 went high (see txDoneMicros and rxDoneMicros)
+#ifdef NOT_AN_INTERRUPT
+  if (digitalPinToInterrupt(SX1262_DIO1) != NOT_AN_INTERRUPT) {
+    interruptRadio = this;
+    attachInterrupt(digitalPinToInterrupt(SX1262_DIO1), dio1Interrupt, RISING);
+  }
+#endif
+
   //Hardware reset the radio by toggling the reset pin
   digitalWrite(SX1262_RESET, 0); delay(100);
   digitalWrite(SX1262_RESET, 1); delay(100);
@@ -41,6 +53,7 @@ bool LoraSx1262::begin() {
   
   
   //Ensure SPI communication is working with the radio
+  syncWordMsb = 0x14;  //The reset put the sync word back to its default
   bool success = sanityCheck();
   if (!success) { return false; }
 
@@ -58,20 +71,15 @@ bool LoraSx1262::begin() {
 */
 bool LoraSx1262::sanityCheck() {
 
-  uint16_t addressToRead = 0x0740;
   SPI.beginTransaction(SPISettings(500000, MSBFIRST, SPI_MODE0));
   delay(10);
 
-  digitalWrite(SX1262_NSS, 0);  //CS Low = Enabled
-  SPI.transfer(0x1D); //OpCode for "read register"
-  SPI.transfer16(addressToRead);
-  SPI.transfer(0x00);  //Dummy byte
-  uint8_t regValue = SPI.transfer(0x00);  //Read response
-  digitalWrite(SX1262_NSS, 1);  //CS High = Disabled
+  uint8_t regValue = 0x00;
+  readRegister(0x0740, &regValue, 1);  //LoRa sync word MSB.  0x14 after a reset, unless configSetSyncWord() changed it
   
   Serial.println(regValue,HEX);
 
-  return regValue == 0x14;  //Success if we read 0x14 from the register
+  return regValue == syncWordMsb;  //Success if we read the value we expect from the register
 }
 
 /*Send the bare-bones required commands needed for radio to run.
@@ -87,10 +95,6 @@ void LoraSx1262::configureRadioEssentials() {
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
   delay(100); //Give time for the radio to proces command
 
-  //Just a single SPI command to set the frequency, but it's broken out
-  //into its own function so we can call it on-the-fly when the config changes
-  this->configSetFrequency(915000000);  //Set default frequency to 915mhz
-
   //Set modem to LoRa (described in datasheet section 13.4.2)
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x8A;          //Opcode for "SetPacketType"
@@ -102,13 +106,19 @@ void LoraSx1262::configureRadioEssentials() {
   //Set Rx Timeout to reset on SyncWord or Header detection
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x9F;          //Opcode for "StopTimerOnPreamble"
-  spiBuff[1] = 0x00;          //Stop timer on:  0x00=SyncWord or header detection, 0x01=preamble detection  SPI.transfer(spiBuff,2);
+  spiBuff[1] = 0x00;          //Stop timer on:  0x00=SyncWord or header detection, 0x01=preamble detection
+  SPI.transfer(spiBuff,2);
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
   delay(100);                  //Give time for radio to process the command
 
-  //Set modulation parameters is just one more SPI command, but since it
-  //is often called frequently when changing the radio config, it's broken up into its own function
+  //Frequency and modulation parameters are just two more SPI commands, but since they
+  //are often changed on-the-fly, they go through the same config code the user calls.
+  //The radio was just reset, so forget what we think it has.  That way every setting counts as "changed" and gets sent
+  memset(&(this->config),0,sizeof(this->config));
+  this->configBegin();
+  this->configSetFrequency(915000000);    //Set default frequency to 915mhz
   this->configSetPreset(PRESET_DEFAULT);  //Sets default modulation parameters
+  this->configCommit();
 
   // Set PA Config
   // See datasheet 13.1.4 for descriptions and optimal settings recommendations
@@ -145,8 +155,8 @@ void LoraSx1262::configureRadioEssentials() {
   //Enable interrupts
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x08;        //0x08 is the opcode for "SetDioIrqParams"
-  spiBuff[1] = 0x00;        //IRQMask MSB.  IRQMask is "what interrupts are enabled"
-  spiBuff[2] = 0x02;        //IRQMask LSB         See datasheet table 13-29 for details
+  spiBuff[1] = 0x02;        //IRQMask MSB.  IRQMask is "what interrupts are enabled".  0x02 = Timeout (end of an Rx window)
+  spiBuff[2] = 0x03;        //IRQMask LSB         See datasheet table 13-29 for details.  0x02 = RxDone, 0x01 = TxDone
   spiBuff[3] = 0xFF;        //DIO1 mask MSB.  Of the interrupts detected, which should be triggered on DIO1 pin
   spiBuff[4] = 0xFF;        //DIO1 Mask LSB
   spiBuff[5] = 0x00;        //DIO2 Mask MSB
@@ -160,20 +170,51 @@ void LoraSx1262::configureRadioEssentials() {
 
 
 void LoraSx1262::transmit(byte *data, int dataLen) {
+  transmitPrepare(NULL, 0, data, dataLen);
+  transmitStart();
+}
+
+/*Transmit a packet, starting at an exact point in time.
+The radio is loaded with the packet right away, and then the transmission is started when micros() reaches startMicros.
+This is useful for time-slotted networks, where every radio has to stay inside its own slot.
+Loading the packet takes about 15-20ms, so call this at least that long before startMicros.
+
+Returns TRUE once the packet has been sent.
+Returns FALSE (without transmitting) if startMicros had already passed by the time the packet was loaded
+*/
+bool LoraSx1262::transmitAt(byte *data, int dataLen, uint32_t startMicros) {
+  transmitPrepare(NULL, 0, data, dataLen);
+  return transmitStartAt(startMicros);
+}
+
+//Load a packet into the radio, without transmitting it yet.
+//The packet payload is the header followed by data.  header can be NULL (with headerLen=0) if there isn't one
+void LoraSx1262::transmitPrepare(byte *header, int headerLen, byte *data, int dataLen) {
   //Max lora packet size is 255 bytes
-  if (dataLen > 255) { dataLen = 255;}
+  if (headerLen + dataLen > 255) { dataLen = 255 - headerLen;}
 
   //Switching directly from rx to tx mode is slow. Go to standby first
   if (inReceiveMode) {
     setModeStandby();
   }
 
+  //The radio sends and receives through the same buffer (both base addresses are 0x00), so loading this packet
+  //overwrites any received packet that wasn't read yet.  Drop its RxDone too, so lora_receive_async() doesn't return it mangled.
+  //Read packets with lora_receive_async() before transmitting if you don't want to lose them
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0x02;          //Opcode for ClearIRQStatus command
+  spiBuff[1] = 0xFF;          //IRQ bits to clear (MSB) (0xFFFF means clear all interrupts)
+  spiBuff[2] = 0xFF;          //IRQ bits to clear (LSB)
+  SPI.transfer(spiBuff,3);
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+  takeDio1Timestamp();        //Throw away the timestamp of whatever we just cleared, so transmitStart() only catches TxDone
+
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x8C;          //Opcode for "SetPacketParameters"
   spiBuff[1] = 0x00;          //PacketParam1 = Preamble Len MSB
   spiBuff[2] = 0x0C;          //PacketParam2 = Preamble Len LSB
   spiBuff[3] = 0x00;          //PacketParam3 = Header Type. 0x00 = Variable Len, 0x01 = Fixed Length
-  spiBuff[4] = dataLen;       //PacketParam4 = Payload Length (Max is 255 bytes)
+  spiBuff[4] = headerLen + dataLen; //PacketParam4 = Payload Length (Max is 255 bytes)
   spiBuff[5] = 0x00;          //PacketParam5 = CRC Type. 0x00 = Off, 0x01 = on
   spiBuff[6] = 0x00;          //PacketParam6 = Invert IQ.  0x00 = Standard, 0x01 = Inverted
   SPI.transfer(spiBuff,7);
@@ -185,7 +226,8 @@ void LoraSx1262::transmit(byte *data, int dataLen) {
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x0E,          //Opcode for WriteBuffer command
   spiBuff[1] = 0x00;          //Dummy byte before writing payload
-  SPI.transfer(spiBuff,2);    //Send header info
+  if (headerLen > 0) { memcpy(&(spiBuff[2]),header,headerLen); } //Header goes out right behind the command (it's only a few bytes)
+  SPI.transfer(spiBuff,2 + headerLen);    //Send header info
 
   //SPI.transfer overwrites original buffer.  This could probably be confusing to the user
   //If they tried writing the same buffer twice and got different results
@@ -205,7 +247,24 @@ void LoraSx1262::transmit(byte *data, int dataLen) {
 
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
   waitForRadioCommandCompletion(1000);   //Give time for radio to process the command
+}
+
+//Wait until micros() reaches startMicros, then transmit the packet loaded by transmitPrepare()
+//Returns FALSE (without transmitting) if startMicros already passed
+bool LoraSx1262::transmitStartAt(uint32_t startMicros) {
+  int32_t remaining = (int32_t)(startMicros - micros());
+  if (remaining < 0) { return false; }  //Too late.  Transmitting now would run into someone else's time
+
+  //Sleep off most of the wait, then spin for the last millisecond or two so we start right on time
+  if (remaining > 2000) { delay((remaining - 1000) / 1000); }
+  while ((int32_t)(micros() - startMicros) < 0) {}
+
+  transmitStart();
+  return true;
+}
 
+//Transmit the packet loaded by transmitPrepare(), and wait for it to finish
+void LoraSx1262::transmitStart() {
   //Transmit!
   // An interrupt will be triggered if we surpass our timeout
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
@@ -215,12 +274,45 @@ void LoraSx1262::transmit(byte *data, int dataLen) {
   spiBuff[3] = 0xFF;          //Timeout (3-byte number)
   SPI.transfer(spiBuff,4);
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
-  waitForRadioCommandCompletion(this->transmitTimeout); //Wait for tx to complete, with a timeout so we don't wait forever
+
+  //TxDone raises DIO1 (transmitPrepare() cleared everything else).  transmitTimeout is only a failsafe in case the radio stops responding
+  uint32_t startTime = millis();
+  while (digitalRead(SX1262_DIO1) == false) {
+    if (millis() - startTime >= this->transmitTimeout) { break; }
+    yield();
+  }
+  txDoneMicros = takeDio1Timestamp();
+
+  //Clear TxDone, so DIO1 goes low again
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0x02;          //Opcode for ClearIRQStatus command
+  spiBuff[1] = 0x00;          //IRQ bits to clear (MSB)
+  spiBuff[2] = 0x01;          //IRQ bits to clear (LSB).  0x01 = TxDone
+  SPI.transfer(spiBuff,3);
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
 
   //Remember that we are in Tx mode.  If we want to receive a packet, we need to switch into receiving mode
   inReceiveMode = false;
 }
 
+//Returns the micros() time that DIO1 last went high.
+//If DIO1 isn't on an interrupt pin, the best we can do is "now", so check DIO1 often
+uint32_t LoraSx1262::takeDio1Timestamp() {
+  noInterrupts();
+  bool stamped = dio1Stamped;
+  uint32_t timestamp = dio1Micros;
+  dio1Stamped = false;
+  interrupts();
+  return stamped ? timestamp : micros();
+}
+
+//Interrupt handler for DIO1.  Only records the time, all SPI work happens outside of the interrupt
+void LoraSx1262::dio1Interrupt() {
+  if (interruptRadio == NULL || interruptRadio->dio1Stamped) { return; }
+  interruptRadio->dio1Micros = micros();
+  interruptRadio->dio1Stamped = true;
+}
+
 /**This command will wait until the radio reports that it is no longer busy.
 This is useful when waiting for commands to finish that take a while such as transmitting packets.
 Specify a timeout (in milliseconds) to avoid an infinite loop if something happens to the radio
@@ -262,6 +354,12 @@ bool LoraSx1262::waitForRadioCommandCompletion(uint32_t timeout) {
       dataTransmitted = true;
     }
 
+    //Same for receive mode (0x05).  The radio only gets there once SetRx is done, and it won't report
+    //a finished command status while it's listening.  Waiting for one would just burn the whole timeout
+    if (chipMode == 0x05) {
+      dataTransmitted = true;
+    }
+
     //Avoid infinite loop by implementing a timeout
     if (millis() - startTime >= timeout) {
       return false;
@@ -275,7 +373,12 @@ bool LoraSx1262::waitForRadioCommandCompletion(uint32_t timeout) {
 //Sets the radio into receive mode, allowing it to listen for incoming packets.
 //If radio is already in receive mode, this does nothing.
 //There's no such thing as "setModeTransmit" because it is set automatically when transmit() is called
-void LoraSx1262::setModeReceive() {
+//
+//timeoutSteps is the 24-bit SetRx timeout, in steps of 15.625us.
+//  0xFFFFFF = continuous receive (default). Radio stays in Rx after every packet
+//  0x000000 = single receive, no timeout.  Radio goes to standby after one packet
+//  Anything else = single receive window.  Radio goes to standby after one packet, or raises the Timeout interrupt
+void LoraSx1262::setModeReceive(uint32_t timeoutSteps) {
   if (inReceiveMode) { return; }  //We're already in receive mode, this would do nothing
 
   //Set packet parameters
@@ -295,15 +398,16 @@ void LoraSx1262::setModeReceive() {
   // Based on our previous config, this should throw an interrupt when we get a packet
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x82;          //0x82 is the opcode for "SetRX"
-  spiBuff[1] = 0xFF;          //24-bit timeout, 0xFFFFFF means no timeout
-  spiBuff[2] = 0xFF;          // ^^
-  spiBuff[3] = 0xFF;          // ^^
+  spiBuff[1] = (timeoutSteps >> 16) & 0xFF; //24-bit timeout, 0xFFFFFF means no timeout
+  spiBuff[2] = (timeoutSteps >>  8) & 0xFF; // ^^
+  spiBuff[3] = (timeoutSteps >>  0) & 0xFF; // ^^
   SPI.transfer(spiBuff,4);
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
   waitForRadioCommandCompletion(100);
 
   //Remember that we're in receive mode so we don't need to run this code again unnecessarily
   inReceiveMode = true;
+  receiveContinuous = (timeoutSteps == 0xFFFFFF);
 }
 
 /*Set radio into standby mode.
@@ -335,6 +439,18 @@ int LoraSx1262::lora_receive_async(byte* buff, int buffMaxLen) {
   //Radio pin DIO1 (interrupt) goes high when we have a packet ready.  If it's low, there's no packet yet
   if (digitalRead(SX1262_DIO1) == false) { return -1; } //Return -1, meanining no packet ready
 
+  uint32_t dio1Time = takeDio1Timestamp();  //Grab this as early as possible
+
+  //DIO1 is shared between RxDone and Timeout, so ask the radio which one it was
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0x12;          //Opcode for GetIrqStatus command
+  spiBuff[1] = 0xFF;          //Dummy.  Returns radio status
+  spiBuff[2] = 0xFF;          //Dummy.  Returns IRQ status MSB
+  spiBuff[3] = 0xFF;          //Dummy.  Returns IRQ status LSB
+  SPI.transfer(spiBuff,4);
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+  uint16_t irqStatus = ((uint16_t)spiBuff[2] << 8) | spiBuff[3];
+
   //Tell the radio to clear the interrupt, and set the pin back inactive.
   while (digitalRead(SX1262_DIO1)) {
     //Clear all interrupt flags.  This should result in the interrupt pin going low
@@ -346,6 +462,14 @@ int LoraSx1262::lora_receive_async(byte* buff, int buffMaxLen) {
     digitalWrite(SX1262_NSS,1); //Disable radio chip-select
   }
 
+  //Outside of continuous receive mode, the radio drops back to standby on its own after RxDone or Timeout
+  if (!receiveContinuous) { inReceiveMode = false; }
+
+  //No RxDone bit (0x0002) means the receive window closed without a packet
+  rxTimedOut = !(irqStatus & 0x0002);
+  if (rxTimedOut) { return -1; }
+  rxDoneMicros = dio1Time;
+
   // (Optional) Read the packet status info from the radio.
   // This is things like radio strength, noise, etc.
   // See datasheet 13.5.3 for more info
@@ -378,6 +502,20 @@ int LoraSx1262::lora_receive_async(byte* buff, int buffMaxLen) {
   uint8_t payloadLen = spiBuff[2];    //How long the lora packet is
   uint8_t startAddress = spiBuff[3];  //Where in 1262 memory is the packet stored
 
+  //If we're filtering by address, peek at just the address first.  Not ours?  Don't bother reading the rest
+  if (addressFilterLen > 0) {
+    if (payloadLen < addressFilterLen) { return -1; }
+
+    digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+    spiBuff[0] = 0x1E;          //Opcode for ReadBuffer command
+    spiBuff[1] = startAddress;  //SX1262 memory location to start reading from
+    spiBuff[2] = 0x00;          //Dummy byte
+    SPI.transfer(spiBuff,3+addressFilterLen);  //Returns the address, starting at spiBuff[3]
+    digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+
+    if (memcmp(&spiBuff[3], addressFilter, addressFilterLen) != 0) { return -1; }  //Someone else's packet
+  }
+
   //Make sure we don't overflow the buffer if the packet is larger than our buffer
   if (buffMaxLen < payloadLen) {payloadLen = buffMaxLen;}
 
@@ -401,42 +539,120 @@ If a smaller buffer is used, maxBuffLen can be set to avoid buffer overflow. Any
 Returns -1 when no packet is available and timeout was hit.
 Returns 0 when an empty packet is received (packet with no payload)
 Returns payload size (1-255) when a packet with a non-zero payload is received. If packet received is larger than the buffer provided, this will return buffMaxLen
+
+This keeps the microcontroller busy while it waits.  Use lora_receive_window() if you want it to sleep instead.
+The radio is left in continuous receive mode when this returns
 */
 int LoraSx1262::lora_receive_blocking(byte *buff, int buffMaxLen, uint32_t timeout) {
-  setModeReceive(); //Sets the mode to receive (if not already in receive mode)
-
   uint32_t startTime = millis();
-  uint32_t elapsed = startTime;
 
-  //Wait for radio interrupt pin to go high, indicating a packet was received, or if we hit our timeout
-  while (digitalRead(SX1262_DIO1) == false) {
-    //If user specified a timeout, check if we hit it
-    if (timeout > 0) {
-      elapsed = millis() - startTime;
-      if (elapsed >= timeout) {
+  //A packet may already be waiting for us from continuous receive mode.  Don't throw it away by restarting the radio
+  if (inReceiveMode && digitalRead(SX1262_DIO1)) {
+    int len = lora_receive_async(buff,buffMaxLen);
+    if (len >= 0) { return len; }
+    //Otherwise it was dropped by the address filter (see configSetAddressFilter()).  Keep waiting
+  }
+
+  //If the radio isn't listening yet, it can time the window itself (up to ~262 seconds), so we only need to watch DIO1.
+  //It goes high for both RxDone and Timeout, and lora_receive_async() figures out which one it was.
+  //If it's already in continuous receive mode, leave it alone: restarting it would cut off a packet that's arriving right now
+  bool alreadyListening = inReceiveMode && receiveContinuous;
+  if (timeout > 0 && timeout <= 262143UL && !alreadyListening) {
+    int len = receiveWithRadioTimeout(buff, buffMaxLen, timeout, startTime);
+    setModeReceive();  //Keep listening between calls, so packets that arrive before the next call aren't missed
+    return len;
+  }
+
+  //No timeout (or one that's too long for the radio): use continuous receive mode, and time it ourselves
+  setModeReceive(); //Sets the mode to receive (if not already in receive mode)
+
+  while (true) {
+    //Wait for radio interrupt pin to go high, indicating a packet was received, or if we hit our timeout
+    while (digitalRead(SX1262_DIO1) == false) {
+      //If user specified a timeout, check if we hit it
+      if (timeout > 0 && millis() - startTime >= timeout) {
+        rxTimedOut = true;
         return -1;    //Return error, saying that we hit our timeout
       }
+      yield();
     }
+
+    //If our pin went high, then we got a packet!  Return it, unless the address filter dropped it
+    int len = lora_receive_async(buff,buffMaxLen);
+    if (len >= 0) { return len; }
   }
+}
 
-  //If our pin went high, then we got a packet!  Return it
-  return lora_receive_async(buff,buffMaxLen);
+//The radio-timed part of lora_receive_blocking().  Opens single receive windows until a packet arrives, or the timeout runs out.
+//Leaves the radio in standby
+int LoraSx1262::receiveWithRadioTimeout(byte *buff, int buffMaxLen, uint32_t timeout, uint32_t startTime) {
+  //The radio is in charge of the timeout. millis() is only a failsafe in case the radio stops responding.
+  //The radio's timer stops once it locks onto a packet, so a packet that starts near the end of the window
+  //can finish up to one (longest) packet later than the timeout.  Leave room for that
+  uint32_t failsafe = timeout + getTimeOnAir(255) / 1000 + 100;
+
+  while (true) {
+    uint32_t elapsed = millis() - startTime;
+    if (elapsed >= timeout) {
+      rxTimedOut = true;
+      return -1;
+    }
+    lora_receive_window((timeout - elapsed) * 1000UL);  //Only listen for whatever time is left
+
+    while (digitalRead(SX1262_DIO1) == false) {
+      if (millis() - startTime > failsafe) {
+        setModeStandby();  //Radio didn't answer.  Stop it, so our idea of what mode it's in stays correct
+        rxTimedOut = true;
+        return -1;
+      }
+      yield();
+    }
+
+    int len = lora_receive_async(buff,buffMaxLen);
+    if (len >= 0 || rxTimedOut) { return len; }
+    //Packet was dropped by the address filter.  Open a new window for the rest of the timeout
+  }
+}
+
+/*Open a single receive window that is timed by the radio instead of the microcontroller.
+This returns immediately.  DIO1 goes high when a packet is received or when the window closes,
+so the microcontroller is free to sleep (or do other work) until then.  Call lora_receive_async() afterwards
+to collect the packet.  If the window closed empty, lora_receive_async() returns -1 and sets rxTimedOut.
+
+timeoutMicros is the length of the window in microseconds. The radio counts in steps of 15.625us,
+so windows can be up to 262143937us (~262 seconds).  Set to 0 to wait for a single packet with no timeout.
+
+Returns TRUE when the window was opened, FALSE if the timeout is too long for the radio
+*/
+bool LoraSx1262::lora_receive_window(uint32_t timeoutMicros) {
+  //0xFFFFFF is reserved for continuous receive, so 0xFFFFFE steps is the longest window
+  if (timeoutMicros > 262143937UL) { return false; }
+
+  //Convert to 15.625us steps.  (us / 15.625) is the same as (us * 8 / 125), without needing floats
+  uint32_t timeoutSteps = (timeoutMicros * 8UL) / 125UL;
+  if (timeoutSteps == 0 && timeoutMicros > 0) { timeoutSteps = 1; } //Don't round tiny windows down to "no timeout"
+
+  //SetRx has to be sent from standby to (re)start the radio's timer
+  if (inReceiveMode) { setModeStandby(); }
+  rxTimedOut = false;
+  setModeReceive(timeoutSteps);
+  return true;
 }
 
 //Set the radio frequency.  Just a single SPI call,
 //but this is broken out to make it more convenient to change frequency on-the-fly
-//You must set this->pllFrequency before calling this
+//You must set this->config.pllFrequency before calling this
 void LoraSx1262::updateRadioFrequency() {
   //Set PLL frequency (this is a complicated math equation.  See datasheet entry for SetRfFrequency)
   digitalWrite(SX1262_NSS,0); //Enable radio chip-select
   spiBuff[0] = 0x86;  //Opcode for set RF Frequencty
-  spiBuff[1] = (this->pllFrequency >> 24) & 0xFF;  //MSB of pll frequency
-  spiBuff[2] = (this->pllFrequency >> 16) & 0xFF;  //
-  spiBuff[3] = (this->pllFrequency >>  8) & 0xFF;  //
-  spiBuff[4] = (this->pllFrequency >>  0) & 0xFF;  //LSB of requency
+  spiBuff[1] = (this->config.pllFrequency >> 24) & 0xFF;  //MSB of pll frequency
+  spiBuff[2] = (this->config.pllFrequency >> 16) & 0xFF;  //
+  spiBuff[3] = (this->config.pllFrequency >>  8) & 0xFF;  //
+  spiBuff[4] = (this->config.pllFrequency >>  0) & 0xFF;  //LSB of requency
   SPI.transfer(spiBuff,5);
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
-  delay(100);                  //Give time for the radio to proces command
+  delayMicroseconds(100);     //Radio is only busy for a few us after a config command in standby.  This covers it without needing the BUSY pin
 }
 
 //Set the radio modulation parameters.
@@ -454,20 +670,20 @@ void LoraSx1262::updateModulationParameters() {
   # You just MUST call "setModulationParameters", otherwise the radio won't work at all*/
   digitalWrite(SX1262_NSS,0);       //Enable radio chip-select
   spiBuff[0] = 0x8B;                //Opcode for "SetModulationParameters"
-  spiBuff[1] = this->spreadingFactor;     //ModParam1 = Spreading Factor.  Can be SF5-SF12, written in hex (0x05-0x0C)
-  spiBuff[2] = this->bandwidth;           //ModParam2 = Bandwidth.  See Datasheet 13.4.5.2 for details. 0x00=7.81khz (slowest)
-  spiBuff[3] = this->codingRate;          //ModParam3 = CodingRate.  Semtech recommends CR_4_5 (which is 0x01).  Options are 0x01-0x04, which correspond to coding rate 5-8 respectively
-  spiBuff[4] = this->lowDataRateOptimize; //LowDataRateOptimize.  0x00 = 0ff, 0x01 = On.  Required to be on for SF11 + SF12
+  spiBuff[1] = this->config.spreadingFactor;     //ModParam1 = Spreading Factor.  Can be SF5-SF12, written in hex (0x05-0x0C)
+  spiBuff[2] = this->config.bandwidth;           //ModParam2 = Bandwidth.  See Datasheet 13.4.5.2 for details. 0x00=7.81khz (slowest)
+  spiBuff[3] = this->config.codingRate;          //ModParam3 = CodingRate.  Semtech recommends CR_4_5 (which is 0x01).  Options are 0x01-0x04, which correspond to coding rate 5-8 respectively
+  spiBuff[4] = this->config.lowDataRateOptimize; //LowDataRateOptimize.  0x00 = 0ff, 0x01 = On.  Required to be on for SF11 + SF12
   SPI.transfer(spiBuff,5);
   digitalWrite(SX1262_NSS,1); //Disable radio chip-select
-  delay(100);                  //Give time for radio to process the command
+  delayMicroseconds(100);     //Radio is only busy for a few us after a config command in standby.  This covers it without needing the BUSY pin
 
   //Come up with a reasonable timeout for transmissions
   //SF12 is painfully slow, so we want a nice long timeout for that,
   //but we really don't want someone using SF5 to have to wait MINUTES for a timeout
   //I came up with these timeouts by measuring how long it actually took to transmit a packet
   //at each spreading factor with a MAX 255-byte payload and 7khz Bandwitdh (the slowest one)
-  switch (this->spreadingFactor) {
+  switch (this->config.spreadingFactor) {
     case 12:
       this->transmitTimeout = 252000; //Actual tx time 126 seconds
       break;
@@ -496,6 +712,42 @@ void LoraSx1262::updateModulationParameters() {
 }
 
 
+/*How long (in microseconds) it takes to transmit a packet with payloadLen bytes, using the current radio config.
+This follows the time-on-air formula in datasheet section 6.1.4, using the packet settings this library always uses
+(12 symbol preamble, explicit header, no CRC).
+*/
+uint32_t LoraSx1262::getTimeOnAir(int payloadLen) {
+  uint32_t bandwidthHz;
+  switch (this->config.bandwidth) {
+    case 0x00: bandwidthHz =   7810; break;
+    case 0x08: bandwidthHz =  10420; break;
+    case 0x01: bandwidthHz =  15630; break;
+    case 0x09: bandwidthHz =  20830; break;
+    case 0x02: bandwidthHz =  31250; break;
+    case 0x0A: bandwidthHz =  41670; break;
+    case 0x03: bandwidthHz =  62500; break;
+    case 0x04: bandwidthHz = 125000; break;
+    case 0x05: bandwidthHz = 250000; break;
+    default:   bandwidthHz = 500000; break;
+  }
+  int sf = this->config.spreadingFactor;
+
+  //Payload bits (plus the 20-bit explicit header) that don't fit in the first 8 symbols.  SF7+ also spends 8 bits on a fixed overhead
+  long bits = 8L * payloadLen - 4 * sf + 20 + ((sf >= 7) ? 8 : 0);
+  if (bits < 0) { bits = 0; }
+
+  //Each group of (CR+4) symbols carries 4*SF bits, or 4*(SF-2) with LowDataRateOptimize on
+  int bitsPerGroup = 4 * (this->config.lowDataRateOptimize ? sf - 2 : sf);
+  long payloadSymbols = 8 + ((bits + bitsPerGroup - 1) / bitsPerGroup) * (this->config.codingRate + 4);
+
+  //The sync word adds 4.25 symbols after the preamble (6.25 for SF5 and SF6).
+  //Count in quarter-symbols so we don't need floats for this part
+  long quarterSymbols = 4 * (12 + payloadSymbols) + ((sf < 7) ? 25 : 17);
+  float symbolMicros = (float)(1UL << sf) * 1000000.0f / bandwidthHz;
+  return (uint32_t)(quarterSymbols * symbolMicros / 4);
+}
+
+
 //--------------------------
 // ADVANCED FUNCTIONS
 //--------------------------
@@ -515,35 +767,29 @@ void LoraSx1262::updateModulationParameters() {
 *                         reliability over speed, or when transmitting over long distances
 */
 bool LoraSx1262::configSetPreset(int preset) {
+  if (preset != PRESET_DEFAULT && preset != PRESET_LONGRANGE && preset != PRESET_FAST) { return configRejectChange(); } //Invalid preset specified
+
+  bool commitNow = configStartChange();
   if (preset == PRESET_DEFAULT) {
-    this->bandwidth = 5;            //250khz
-    this->codingRate = 1;           //CR_4_5
-    this->spreadingFactor = 7;      //SF7
-    this->lowDataRateOptimize = 0;  //Don't optimize (used for SF12 only)
-    this->updateModulationParameters();
-    return true;
+    this->stagedConfig.bandwidth = 5;            //250khz
+    this->stagedConfig.codingRate = 1;           //CR_4_5
+    this->stagedConfig.spreadingFactor = 7;      //SF7
   }
 
   if (preset == PRESET_LONGRANGE) {
-    this->bandwidth = 4;            //125khz
-    this->codingRate = 1;           //CR_4_5
-    this->spreadingFactor = 12;     //SF12
-    this->lowDataRateOptimize = 1;  //Optimize for low data rate (SF12 only)
-    this->updateModulationParameters();
-    return true;
+    this->stagedConfig.bandwidth = 4;            //125khz
+    this->stagedConfig.codingRate = 1;           //CR_4_5
+    this->stagedConfig.spreadingFactor = 12;     //SF12
   }
 
   if (preset == PRESET_FAST) {
-    this->bandwidth = 6;            //500khz
-    this->codingRate = 1;           //CR_4_5
-    this->spreadingFactor = 5;      //SF5
-    this->lowDataRateOptimize = 0;  //Don't optimize (used for SF12 only)
-    this->updateModulationParameters();
-    return true;
+    this->stagedConfig.bandwidth = 6;            //500khz
+    this->stagedConfig.codingRate = 1;           //CR_4_5
+    this->stagedConfig.spreadingFactor = 5;      //SF5
   }
 
-  //Invalid preset specified
-  return false;
+  //LowDataRateOptimize is worked out in configCommit(), from the final spreading factor
+  return commitNow ? configCommit() : true;
 }
 
 /** (Optional) Set the operating frequency of the radio.
@@ -556,13 +802,13 @@ bool LoraSx1262::configSetPreset(int preset) {
 */
 bool LoraSx1262::configSetFrequency(long frequencyInHz) {
   //Make sure the specified frequency is in the valid range.
-  if (frequencyInHz < 150000000 || frequencyInHz > 960000000) { return false;}
+  if (frequencyInHz < 150000000 || frequencyInHz > 960000000) { return configRejectChange(); }
 
   //Calculate the PLL frequency (See datasheet section 13.4.1 for calculation)
   //PLL frequency controls the radio's clock multipler to achieve the desired frequency
-  this->pllFrequency = frequencyToPLL(frequencyInHz);
-  updateRadioFrequency();
-  return true;
+  bool commitNow = configStartChange();
+  this->stagedConfig.pllFrequency = frequencyToPLL(frequencyInHz);
+  return commitNow ? configCommit() : true;
 }
 
 /*Set the bandwith (basically, this is how big the frequency span is that we occupy)
@@ -587,10 +833,10 @@ bool LoraSx1262::configSetFrequency(long frequencyInHz) {
 */
 bool LoraSx1262::configSetBandwidth(int bandwidth) {
   //Bandwidth setting must be 0-10 (excluding 7 for some reason)
-  if (bandwidth < 0 || bandwidth > 0x0A || bandwidth == 7) { return false; }
-  this->bandwidth = bandwidth;
-  this->updateModulationParameters();
-  return true;
+  if (bandwidth < 0 || bandwidth > 0x0A || bandwidth == 7) { return configRejectChange(); }
+  bool commitNow = configStartChange();
+  this->stagedConfig.bandwidth = bandwidth;
+  return commitNow ? configCommit() : true;
 }
 
 /*I honestly don't really know what coding rate means.  It's something technical to have to do with radios
@@ -606,10 +852,10 @@ bool LoraSx1262::configSetBandwidth(int bandwidth) {
 */
 bool LoraSx1262::configSetCodingRate(int codingRate) {
   //Coding rate must be 1-4 (inclusive)
-  if (codingRate < 1 || codingRate > 4) { return false; }
-  this->codingRate = codingRate;
-  this->updateModulationParameters();
-  return true;
+  if (codingRate < 1 || codingRate > 4) { return configRejectChange(); }
+  bool commitNow = configStartChange();
+  this->stagedConfig.codingRate = codingRate;
+  return commitNow ? configCommit() : true;
 }
 
 /*Change the spreading factor of a packet
@@ -631,15 +877,235 @@ Lower spreading factors are good when the radios are close, which allows faster
 * Returns TRUE on success, FALSE on failure (incorrect spreading factor)
 */
 bool LoraSx1262::configSetSpreadingFactor(int spreadingFactor) {
+  if (spreadingFactor < 5 || spreadingFactor > 12) { return configRejectChange(); }
+
+  //LowDataRateOptimize follows the spreading factor.  configCommit() sets it (see lowDataRateOptimizeFor())
+  bool commitNow = configStartChange();
+  this->stagedConfig.spreadingFactor = spreadingFactor;
+  return commitNow ? configCommit() : true;
+}
+
+/*Start a config transaction.
+After this, configSetFrequency(), configSetBandwidth(), configSetCodingRate(), configSetSpreadingFactor() and configSetPreset()
+only remember the new settings.  Nothing is sent to the radio until configCommit(), which checks the whole set
+and sends only what changed, all at once.  This is much faster than changing settings one by one,
+and the radio never runs with a half-changed config.
+If any of those calls returns FALSE, the whole transaction is rejected: configCommit() returns FALSE and changes nothing.
+*/
+void LoraSx1262::configBegin() {
+  this->stagedConfig = this->config;
+  this->configStaging = true;
+  this->configRejected = false;
+}
+
+/*Finish a config transaction started with configBegin(), and send the changes to the radio.
+The radio goes to standby while it is reconfigured.  The next receive puts it back in receive mode.
+
+Returns TRUE on success.
+Returns FALSE if any setting in the transaction was rejected, the final combination is invalid, or configBegin() wasn't called.
+The radio keeps its old config
+*/
+bool LoraSx1262::configCommit() {
+  if (!this->configStaging) { return false; }
+  this->configStaging = false;
+  if (this->configRejected) { return false; }  //A configSet call failed.  Don't apply the rest of the changes without it
+
+  //The datasheet highly recommends enabling "LowDataRateOptimize" for SF11 and SF12.
+  //Work it out here, so it matches whatever spreading factor we end up with
+  this->stagedConfig.lowDataRateOptimize = lowDataRateOptimizeFor(this->stagedConfig.spreadingFactor);
+  if (!configIsValid(this->stagedConfig)) { return false; }
+  return applyConfig(this->stagedConfig);
+}
+
+//Throw away a config transaction started with configBegin().  Nothing is sent to the radio
+void LoraSx1262::configCancel() {
+  this->configStaging = false;
+  this->configRejected = false;
+}
+
+/*Build a complete radio config ahead of time, without touching the radio.
+Switch to it later with configApplyProfile().  Useful for keeping a few named configs around,
+eg "LoraConfigProfile longRange, fast;", and swapping between them quickly.
+All the checks and math (such as the PLL frequency) are done here, so applying it is just the SPI commands.
+
+Parameters are the same as configSetFrequency(), configSetBandwidth(), configSetCodingRate() and configSetSpreadingFactor().
+Returns TRUE on success, FALSE if any setting is invalid (profile is left unchanged)
+*/
+bool LoraSx1262::configMakeProfile(LoraConfigProfile& profile, long frequencyInHz, int bandwidth, int codingRate, int spreadingFactor) {
+  if (frequencyInHz < 150000000 || frequencyInHz > 960000000) { return false;}
+  if (bandwidth < 0 || bandwidth > 0x0A || bandwidth == 7) { return false; }
+  if (codingRate < 1 || codingRate > 4) { return false; }
   if (spreadingFactor < 5 || spreadingFactor > 12) { return false; }
 
-  //The datasheet highly recommends enabling "LowDataRateOptimize" for SF11 and SF12
-  this->lowDataRateOptimize = (spreadingFactor >= 11) ? 1 : 0;  //Turn on for SF11+SF12, turn off for anything else
-  this->spreadingFactor = spreadingFactor;
-  this->updateModulationParameters();
+  profile.pllFrequency = frequencyToPLL(frequencyInHz);
+  profile.bandwidth = bandwidth;
+  profile.codingRate = codingRate;
+  profile.spreadingFactor = spreadingFactor;
+  profile.lowDataRateOptimize = lowDataRateOptimizeFor(spreadingFactor);
+  return true;
+}
+
+/*Switch the radio to a profile made with configMakeProfile(), in one go.
+Only the settings that differ from the current config are sent.  Any open config transaction is thrown away.
+Returns TRUE on success, FALSE if the profile is invalid.  The profile is checked as-is: a hand-built profile whose
+lowDataRateOptimize doesn't match its spreading factor is rejected, not quietly fixed
+*/
+bool LoraSx1262::configApplyProfile(const LoraConfigProfile& profile) {
+  if (!configIsValid(profile)) { return false; }
+  configCancel();
+  return applyConfig(profile);
+}
+
+//Called at the start of every configSet function.
+//Returns TRUE when there is no open transaction, meaning the caller has to commit the change itself
+bool LoraSx1262::configStartChange() {
+  if (this->configStaging) { return false; }
+  configBegin();
+  return true;
+}
+
+//Called when a configSet function gets an invalid setting.  Inside a transaction, this makes configCommit() fail.
+//Always returns FALSE, so callers can return it directly
+bool LoraSx1262::configRejectChange() {
+  if (this->configStaging) { this->configRejected = true; }
+  return false;
+}
+
+//Checks a full config.  Valid ranges are described in each of the configSet functions.
+//configCommit() works out LowDataRateOptimize before checking, so only configApplyProfile() can fail on it
+bool LoraSx1262::configIsValid(const LoraConfigProfile& profile) {
+  if (profile.pllFrequency < frequencyToPLL(150000000) || profile.pllFrequency > frequencyToPLL(960000000)) { return false; }
+  if (profile.bandwidth > 0x0A || profile.bandwidth == 7) { return false; }
+  if (profile.codingRate < 1 || profile.codingRate > 4) { return false; }
+  if (profile.spreadingFactor < 5 || profile.spreadingFactor > 12) { return false; }
+  if (profile.lowDataRateOptimize != lowDataRateOptimizeFor(profile.spreadingFactor)) { return false; }
+  return true;
+}
+
+//LowDataRateOptimize: turn on for SF11+SF12, turn off for anything else
+uint8_t LoraSx1262::lowDataRateOptimizeFor(uint8_t spreadingFactor) {
+  return (spreadingFactor >= 11) ? 1 : 0;
+}
+
+//Send a (valid) config to the radio.  Only the commands for settings that changed are sent,
+//back to back in a single trip through standby
+bool LoraSx1262::applyConfig(const LoraConfigProfile& profile) {
+  bool frequencyChanged = profile.pllFrequency != this->config.pllFrequency;
+  bool modulationChanged = profile.bandwidth != this->config.bandwidth
+                        || profile.codingRate != this->config.codingRate
+                        || profile.spreadingFactor != this->config.spreadingFactor
+                        || profile.lowDataRateOptimize != this->config.lowDataRateOptimize;
+  if (!frequencyChanged && !modulationChanged) { return true; } //Nothing to do
+
+  //The radio should only be reconfigured from standby
+  if (inReceiveMode) { setModeStandby(); }
+
+  this->config = profile;
+  if (frequencyChanged)  { updateRadioFrequency(); }
+  if (modulationChanged) { updateModulationParameters(); }
+  waitForRadioCommandCompletion(100);  //Give time for radio to process the commands
   return true;
 }
 
+/*Set how many symbols the radio needs to see before it decides a packet is arriving.
+If no packet is locked onto within this many symbols, the receive window ends early and raises the Timeout interrupt.
+This only applies to receive windows (see lora_receive_window()), not continuous receive mode.
+Combined with a short window, this lets a receiver give up on an empty slot after just a few symbols.
+See datasheet 13.4.9 (SetLoRaSymbNumTimeout) for details.
+
+* symbols: 0-255.  0 (default) disables the symbol timeout.  Semtech examples use 5
+
+* Returns TRUE on success, FALSE on failure (invalid number of symbols)
+*/
+bool LoraSx1262::configSetRxSymbolTimeout(int symbols) {
+  if (symbols < 0 || symbols > 255) { return false; }
+
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0xA0;          //Opcode for "SetLoRaSymbNumTimeout"
+  spiBuff[1] = symbols;       //Number of symbols
+  SPI.transfer(spiBuff,2);
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+  waitForRadioCommandCompletion(100);  //Give time for radio to process the command
+  return true;
+}
+
+/*Set the sync word, a network ID that the radio checks in hardware.
+Packets sent with a different sync word are ignored by the radio itself: they never raise DIO1 or wake up the microcontroller.
+Use this to ignore other people's traffic on a busy channel.  Every radio in your network needs the same sync word.
+
+* syncWord: SYNCWORD_PRIVATE (0x12, default), SYNCWORD_PUBLIC (0x34, LoRaWAN), or your own.
+  This is the same one-byte value other LoRa radios (like the SX1276) use.
+  The SX1262 stores it as two bytes, with each nibble followed by 0x4.  See Semtech AN1200.48
+
+* Returns TRUE on success
+*/
+bool LoraSx1262::configSetSyncWord(uint8_t syncWord) {
+  byte registerValue[2];
+  registerValue[0] = (syncWord & 0xF0) | 0x04;         //eg 0x12 -> 0x14
+  registerValue[1] = ((syncWord & 0x0F) << 4) | 0x04;  //eg 0x12 -> 0x24
+
+  //The radio should only be reconfigured from standby.  The next receive puts it back in receive mode
+  if (inReceiveMode) { setModeStandby(); }
+  writeRegister(0x0740, registerValue, 2);  //0x0740 = LoRa sync word MSB, 0x0741 = LSB
+  syncWordMsb = registerValue[0];           //So sanityCheck() knows what to expect
+  return true;
+}
+
+/*Only receive packets that start with a specific address, such as this radio's ID.
+This is done by the library, not the radio.  When a packet arrives, only the first few bytes are read from the radio.
+If they don't match, the rest of the packet is never read, and lora_receive_async() returns -1 as if nothing arrived.
+The address is left at the start of the packets you do receive.
+The transmitter is responsible for putting the address at the start of every packet.
+
+Note that LoraTdma puts its own header at the start of every packet, so this filter shouldn't be used with LoraTdma.
+Use configSetSyncWord() to separate networks instead.
+
+* address: Bytes that every packet must start with.  NULL to turn the filter off
+* addressLen: 1 to LORA_MAX_ADDRESS_LEN bytes.  0 turns the filter off
+
+* Returns TRUE on success, FALSE on failure (address too long)
+*/
+bool LoraSx1262::configSetAddressFilter(const byte* address, int addressLen) {
+  if (address == NULL) { addressLen = 0; }
+  if (addressLen < 0 || addressLen > LORA_MAX_ADDRESS_LEN) { return false; }
+
+  if (addressLen > 0) { memcpy(this->addressFilter, address, addressLen); }
+  this->addressFilterLen = addressLen;
+  return true;
+}
+
+/*Read one or more registers, starting at address.
+Registers are consecutive, so reading 2 bytes from 0x0740 gets 0x0740 and 0x0741.
+See datasheet section 13.2.4 (ReadRegister) and table 12-1 for register addresses
+*/
+void LoraSx1262::readRegister(uint16_t address, byte* data, int dataLen) {
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0x1D;          //Opcode for "ReadRegister"
+  spiBuff[1] = address >> 8;  //Address MSB
+  spiBuff[2] = address;       //Address LSB
+  spiBuff[3] = 0x00;          //Dummy byte.  Returns status
+  SPI.transfer(spiBuff,4);
+  SPI.transfer(data,dataLen); //Get register values and store them into the user provided buffer
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+}
+
+/*Write one or more registers, starting at address.
+See datasheet section 13.2.3 (WriteRegister) and table 12-1 for register addresses.
+Writing the wrong registers can stop the radio from working until it is reset with begin()
+*/
+void LoraSx1262::writeRegister(uint16_t address, const byte* data, int dataLen) {
+  digitalWrite(SX1262_NSS,0); //Enable radio chip-select
+  spiBuff[0] = 0x0D;          //Opcode for "WriteRegister"
+  spiBuff[1] = address >> 8;  //Address MSB
+  spiBuff[2] = address;       //Address LSB
+  SPI.transfer(spiBuff,3);
+  for (int i = 0; i < dataLen; i++) {
+    SPI.transfer(data[i]);    //Register values
+  }
+  digitalWrite(SX1262_NSS,1); //Disable radio chip-select
+  waitForRadioCommandCompletion(100);  //Give time for radio to process the command
+}
+
 /*Convert a frequency in hz (such as 915000000) to the respective PLL setting.
 * The radio requires that we set the PLL, which controls the multipler on the internal clock to achieve the desired frequency.
 * Valid frequencies are 150mhz to 960mhz (150000000 to 960000000)
@@ -46,13 +46,31 @@
 #define PRESET_LONGRANGE  1
 #define PRESET_FAST       2
 
+//Sync words.  Radios only receive packets that were sent with the same sync word as their own
+#define SYNCWORD_PRIVATE  0x12  //Default.  Used by most non-LoRaWAN radios
+#define SYNCWORD_PUBLIC   0x34  //LoRaWAN networks
+
+//Longest address that configSetAddressFilter() can check
+#define LORA_MAX_ADDRESS_LEN 8
+
+//A complete radio config.  Build one ahead of time with configMakeProfile(), then switch to it with configApplyProfile()
+struct LoraConfigProfile {
+  uint32_t pllFrequency;
+  uint8_t bandwidth;
+  uint8_t codingRate;
+  uint8_t spreadingFactor;
+  uint8_t lowDataRateOptimize;
+};
+
 class LoraSx1262 {
   public:
     bool begin();
     bool sanityCheck(); /*Returns true if we have an active SPI communication with the radio*/
     void transmit(byte* data, int dataLen);
+    bool transmitAt(byte* data, int dataLen, uint32_t startMicros); /*Transmits a packet, starting exactly when micros() reaches startMicros*/
     int lora_receive_async(byte* buff, int buffMaxLen); /*Checks to see if a lora packet was received yet, returns the packet if available*/
     int lora_receive_blocking(byte* buff, int buffMaxLen, uint32_t timeout); /*Waits until a packet is received, with an optional timeout*/
+    bool lora_receive_window(uint32_t timeoutMicros); /*Opens a receive window timed by the radio.  DIO1 goes high on packet or timeout*/
 
     //Radio configuration (optional)
     bool configSetPreset(int preset);
@@ -60,31 +78,73 @@ class LoraSx1262 {
     bool configSetBandwidth(int bandwidth);
     bool configSetCodingRate(int codingRate);
     bool configSetSpreadingFactor(int spreadingFactor);
+    bool configSetRxSymbolTimeout(int symbols);
+    bool configSetSyncWord(uint8_t syncWord);
+    bool configSetAddressFilter(const byte* address, int addressLen);
+
+    //Change several settings at once (optional). See configBegin() for details
+    void configBegin();
+    bool configCommit();
+    void configCancel();
+    bool configMakeProfile(LoraConfigProfile& profile, long frequencyInHz, int bandwidth, int codingRate, int spreadingFactor);
+    bool configApplyProfile(const LoraConfigProfile& profile);
     
     //These variables show signal quality, and are updated automatically whenever a packet is received
     int rssi = 0;
     int snr = 0;
     int signalRssi = 0;
+    bool rxTimedOut = false;  //True when the last receive window closed without a packet
+
+    //micros() timestamps of the last radio events. Exact when DIO1 is on an interrupt pin, otherwise taken when DIO1 is noticed
+    uint32_t txDoneMicros = 0;  //When the last transmission finished
+    uint32_t rxDoneMicros = 0;  //When the last received packet finished arriving
+
+    //Direct access to the radio's registers (advanced).  See datasheet section 12 for the register table
+    void readRegister(uint16_t address, byte* data, int dataLen);
+    void writeRegister(uint16_t address, const byte* data, int dataLen);
 
     uint32_t frequencyToPLL(long freqInHz);
+    uint32_t getTimeOnAir(int payloadLen); /*Microseconds it takes to transmit a payload of this size with the current config*/
 
   private:
-    void setModeReceive();  //Puts the radio in receive mode, allowing it to receive packets
+    friend class LoraTdma;  //Needs to load a header + payload ahead of its slot
+    void transmitPrepare(byte* header, int headerLen, byte* data, int dataLen);
+    bool transmitStartAt(uint32_t startMicros);
+    void transmitStart();
+    uint32_t takeDio1Timestamp();
+    static void dio1Interrupt();
+    static LoraSx1262* interruptRadio;
+    volatile uint32_t dio1Micros = 0;
+    volatile bool dio1Stamped = false;
+
+    int receiveWithRadioTimeout(byte* buff, int buffMaxLen, uint32_t timeout, uint32_t startTime);
+    void setModeReceive(uint32_t timeoutSteps = 0xFFFFFF);  //Puts the radio in receive mode, allowing it to receive packets
     void setModeStandby();  //Put radio into standby mode.  Switching from Rx to Tx directly is slow
     void configureRadioEssentials();
     bool waitForRadioCommandCompletion(uint32_t timeout);
     void updateRadioFrequency();
     void updateModulationParameters();
     bool inReceiveMode = false;
+    bool receiveContinuous = true;  //False when the current receive is a single window that ends on its own
     uint8_t spiBuff[32];   //Buffer for sending SPI commands to radio
 
+    bool configStartChange();
+    bool configRejectChange();
+    bool configIsValid(const LoraConfigProfile& profile);
+    uint8_t lowDataRateOptimizeFor(uint8_t spreadingFactor);
+    bool applyConfig(const LoraConfigProfile& profile);
+
     //Config variables (set to PRESET_DEFAULT on init)
-    uint32_t pllFrequency;
-    uint8_t bandwidth;
-    uint8_t codingRate;
-    uint8_t spreadingFactor;
-    uint8_t lowDataRateOptimize;
+    LoraConfigProfile config;         //What the radio is using right now
+    LoraConfigProfile stagedConfig;   //Changes waiting for configCommit()
+    bool configStaging = false;       //True between configBegin() and configCommit()
+    bool configRejected = false;      //True when a configSet call failed during the open transaction
     uint32_t transmitTimeout; //Worst-case transmit time depends on some factors
+
+    //Packets that don't start with these bytes are dropped by lora_receive_async() (see configSetAddressFilter())
+    byte addressFilter[LORA_MAX_ADDRESS_LEN];
+    uint8_t addressFilterLen = 0;
+    uint8_t syncWordMsb = 0x14;  //What sanityCheck() expects to read back from register 0x0740
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,214 @@
+/*License: Creative Commons 4.0 - Attribution, NonCommercial
+* https://creativecommons.org/licenses/by-nc/4.0/
+* Author: Mitch Davis (2023). github.com/thekakester
+*
+* You are free to:
+*    Share — copy and redistribute the material in any medium or format
+*    Adapt — remix, transform, and build upon the material
+* Under the following terms:
+*    Attribution — You must give appropriate credit, provide a link to the license, and indicate if changes were made.
+*                  You may do so in any reasonable manner, but not in any way that suggests the licensor endorses you or your use.
+*    NonCommercial — You may not use the material for commercial purposes.
+*
+* No warranties are given. The license may not give you all of the permissions necessary for your intended use.
+* For example, other rights such as publicity, privacy, or moral rights may limit how you use the material
+*/
+
+#include "Arduino.h"
+#include "LoraTdma.h"
+
+//First byte of every TDMA packet says what kind of packet it is
+#define TDMA_TYPE_BEACON 0xBE
+#define TDMA_TYPE_DATA   0xDA
+
+/*Set up the slot schedule.  Every radio in the network must use the same slotCount, maxPayloadLen, guard time and radio config.
+*
+* radio:         An already initialized radio (call radio.begin() first)
+* slotCount:     Number of slots in a frame, including the coordinator's beacon slot (2-255)
+* mySlot:        Which slot is ours.  Use TDMA_COORDINATOR (0) for the radio that sends beacons, or 1 to slotCount-1 for everyone else
+* maxPayloadLen: Largest payload that will be sent with send().  Slots are sized so this fits
+* guardMicros:   (Optional) Spare time at the end of every slot, so small timing errors don't run into the next slot
+*
+* Returns TRUE on success, FALSE if the settings are invalid, or the frame would be too long (over ~536 seconds)
+*/
+bool LoraTdma::begin(LoraSx1262* radio, int slotCount, int mySlot, int maxPayloadLen, uint32_t guardMicros) {
+  if (slotCount < 2 || slotCount > 255) { return false; }
+  if (mySlot < 0 || mySlot >= slotCount) { return false; }
+  if (maxPayloadLen < 0 || maxPayloadLen > 255 - TDMA_HEADER_LEN) { return false; }
+
+  //A data slot has to fit the biggest packet, plus the guard time
+  uint64_t slotMicros = (uint64_t)radio->getTimeOnAir(maxPayloadLen + TDMA_HEADER_LEN) + guardMicros;
+
+  //The beacon slot is padded with TX_LEAD on both sides of the beacon:
+  //  - Before the beacon, so the coordinator can load it without cutting off the last slot of the previous frame
+  //  - After the beacon, so the radio in slot 1 can load its packet without missing the beacon
+  uint32_t beaconAirMicros = radio->getTimeOnAir(TDMA_HEADER_LEN);
+  uint64_t beaconSlotMicros = (uint64_t)TDMA_TX_LEAD_MICROS + beaconAirMicros + TDMA_TX_LEAD_MICROS + guardMicros;
+  uint64_t frameMicros = beaconSlotMicros + (uint64_t)(slotCount - 1) * slotMicros;
+
+  //Frame times are compared as signed 32-bit micros() differences, over as long as TDMA_SYNC_LOST_FRAMES frames (see isSynced()).
+  //Very slow configs (high spreading factor, big payloads, lots of slots) don't fit
+  if (frameMicros * TDMA_SYNC_LOST_FRAMES > INT32_MAX) { return false; }
+
+  this->radio = radio;
+  this->slotCount = slotCount;
+  this->mySlot = mySlot;
+  this->maxPayloadLen = maxPayloadLen;
+  this->guardMicros = guardMicros;
+  this->slotMicros = slotMicros;
+  this->beaconAirMicros = beaconAirMicros;
+  this->beaconSlotMicros = beaconSlotMicros;
+  this->frameMicros = frameMicros;
+
+  //The coordinator is the clock everyone else syncs to, so it starts a frame right away
+  this->synced = (mySlot == TDMA_COORDINATOR);
+  this->frameStart = micros();
+  this->lastBeaconMicros = frameStart;
+  this->pending = false;
+  return true;
+}
+
+/*Queue a packet to be sent in our next slot.  Only one packet can be queued at a time.
+The data is not copied, so it must stay unchanged until sendPending() returns false.
+
+Returns TRUE when the packet was queued.
+Returns FALSE if a packet is already waiting, or the packet is bigger than maxPayloadLen
+*/
+bool LoraTdma::send(byte* data, int dataLen) {
+  if (pending || mySlot == TDMA_COORDINATOR) { return false; }
+  if (dataLen < 0 || dataLen > maxPayloadLen) { return false; }
+  pendingData = data;
+  pendingLen = dataLen;
+  pending = true;
+  return true;
+}
+
+bool LoraTdma::sendPending() {
+  return pending;
+}
+
+/*Keep the schedule running.  This needs to be called often (at least every idleMicros()), or whenever DIO1 goes high.
+* - Coordinator: sends the beacon at the start of every frame
+* - Everyone else: syncs to beacons, and sends the queued packet in our slot
+*
+* This blocks while our own packet is being sent, the same way transmit() does.
+* Received packets are returned like lora_receive_async(), with the TDMA header removed.  lastSourceSlot says who sent it.
+*
+* Returns -1 when no packet was received (beacons are handled internally, and also return -1)
+* Returns 0-253 when a packet was received.  This is the length of the payload
+*/
+int LoraTdma::poll(byte* buff, int buffMaxLen) {
+  //Collect anything that already arrived before loading our own packet.
+  //The radio sends and receives through the same buffer, so loading a packet would overwrite it
+  int len = receive(buff, buffMaxLen);
+
+  if (wantsToTransmit()) {
+    uint32_t start = nextSlotStart();
+    if ((int32_t)(start - micros()) <= TDMA_TX_LEAD_MICROS) {
+      byte header[TDMA_HEADER_LEN];
+      header[1] = mySlot;
+      if (mySlot == TDMA_COORDINATOR) {
+        header[0] = TDMA_TYPE_BEACON;
+        radio->transmitPrepare(header, TDMA_HEADER_LEN, NULL, 0);
+      } else {
+        header[0] = TDMA_TYPE_DATA;
+        radio->transmitPrepare(header, TDMA_HEADER_LEN, pendingData, pendingLen);
+      }
+
+      if (radio->transmitStartAt(start)) {
+        pending = false;
+      } else {
+        missedSlots++;  //Loading took too long.  Packet stays queued for the next frame
+      }
+
+      //Go straight back to listening, so DIO1 wakes the caller for the next packet
+      radio->setModeReceive();
+    }
+  }
+
+  return len;
+}
+
+//Read a packet from the radio, if there is one.  Beacons are handled here.
+//Returns the payload length (with the TDMA header removed) of a data packet, or -1
+int LoraTdma::receive(byte* buff, int buffMaxLen) {
+  int len = radio->lora_receive_async(buff, buffMaxLen);
+  if (len < TDMA_HEADER_LEN) { return -1; }  //Nothing received, or too short to be one of ours
+
+  if (buff[0] == TDMA_TYPE_BEACON) {
+    //Only trust a real beacon: header only, from the coordinator.  Anything else could move our whole schedule
+    if (len == TDMA_HEADER_LEN && buff[1] == TDMA_COORDINATOR && mySlot != TDMA_COORDINATOR) {
+      //The beacon went out TX_LEAD after the frame started, and finished arriving beaconAirMicros later
+      uint32_t beaconFrameStart = radio->rxDoneMicros - beaconAirMicros - TDMA_TX_LEAD_MICROS;
+
+      //Once synced, beacons should only nudge the schedule by a little clock drift.
+      //A bigger jump is more likely someone else's packet than the coordinator, so ignore it.
+      //If the coordinator really moved, we lose sync after TDMA_SYNC_LOST_FRAMES and pick up the new schedule
+      if (!isSynced() || frameDrift(beaconFrameStart) <= guardMicros) {
+        frameStart = beaconFrameStart;
+        lastBeaconMicros = radio->rxDoneMicros;
+        synced = true;
+      }
+    }
+    return -1;
+  }
+  if (buff[0] != TDMA_TYPE_DATA) { return -1; }  //Someone else's traffic
+
+  lastSourceSlot = buff[1];
+  len -= TDMA_HEADER_LEN;
+  memmove(buff, &(buff[TDMA_HEADER_LEN]), len);
+  return len;
+}
+
+/*How long (in microseconds) until poll() has something scheduled to do.
+If DIO1 goes high first (a packet arrived), call poll() right away instead.
+This lets the caller sleep or do other work between slots.
+Returns 0xFFFFFFFF when nothing is scheduled (only DIO1 can give us work)
+*/
+uint32_t LoraTdma::idleMicros() {
+  if (!wantsToTransmit()) { return 0xFFFFFFFF; }
+  int32_t untilLoad = (int32_t)(nextSlotStart() - micros()) - TDMA_TX_LEAD_MICROS;
+  return (untilLoad > 0) ? untilLoad : 0;
+}
+
+bool LoraTdma::isSynced() {
+  if (mySlot == TDMA_COORDINATOR) { return true; }
+  if (synced && micros() - lastBeaconMicros > TDMA_SYNC_LOST_FRAMES * frameMicros) {
+    synced = false; //Haven't heard the coordinator in a while.  Our clock could have drifted into someone else's slot
+  }
+  return synced;
+}
+
+//Coordinator always has a beacon to send.  Everyone else only needs their slot if they have a packet queued
+bool LoraTdma::wantsToTransmit() {
+  if (mySlot == TDMA_COORDINATOR) { return true; }
+  return pending && isSynced();
+}
+
+//Time from the start of a frame until a slot starts transmitting.
+//The beacon goes out TX_LEAD into slot 0 (see begin())
+uint32_t LoraTdma::slotOffset(int slot) {
+  if (slot == TDMA_COORDINATOR) { return TDMA_TX_LEAD_MICROS; }
+  return beaconSlotMicros + (slot - 1) * slotMicros;
+}
+
+//How far (in microseconds, either direction) a new frame start is from our current schedule
+uint32_t LoraTdma::frameDrift(uint32_t newFrameStart) {
+  int32_t offset = (int32_t)(newFrameStart - frameStart) % (int32_t)frameMicros;
+  if (offset < 0) { offset += frameMicros; }
+  return ((uint32_t)offset > frameMicros / 2) ? frameMicros - offset : offset;
+}
+
+//The next time our slot starts (in micros() time), that we haven't already missed
+uint32_t LoraTdma::nextSlotStart() {
+  uint32_t now = micros();
+
+  //Skip ahead over frames that are already over
+  while ((int32_t)(now - frameStart) >= (int32_t)frameMicros) {
+    frameStart += frameMicros;
+  }
+
+  uint32_t start = frameStart + slotOffset(mySlot);
+  if ((int32_t)(start - now) < 0) { start += frameMicros; }  //Already passed in this frame, use the next one
+  return start;
+}
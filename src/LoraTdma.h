@@ -0,0 +1,84 @@
+/*License: Creative Commons 4.0 - Attribution, NonCommercial
+* https://creativecommons.org/licenses/by-nc/4.0/
+* Author: Mitch Davis (2023). github.com/thekakester
+*
+* You are free to:
+*    Share — copy and redistribute the material in any medium or format
+*    Adapt — remix, transform, and build upon the material
+* Under the following terms:
+*    Attribution — You must give appropriate credit, provide a link to the license, and indicate if changes were made.
+*                  You may do so in any reasonable manner, but not in any way that suggests the licensor endorses you or your use.
+*    NonCommercial — You may not use the material for commercial purposes.
+*
+* No warranties are given. The license may not give you all of the permissions necessary for your intended use.
+* For example, other rights such as publicity, privacy, or moral rights may limit how you use the material
+*/
+
+#ifndef __LORATDMA__
+#define __LORATDMA__
+
+#include <Arduino.h>
+#include "LoraSx1262.h"
+
+/* Time-slotted (TDMA) scheduling on top of LoraSx1262
+#
+# When lots of radios share a channel and transmit whenever they want, their packets run into eachother.
+# Instead, time is split into repeating frames, and every radio gets its own slot in the frame:
+#
+# |<-------------------------------- frame --------------------------------->|
+# +--------------------+-------------+-------------+-----+-------------------+
+# | slot 0 (beacon)    |   slot 1    |   slot 2    | ... | slot slotCount-1  |
+# +--------------------+-------------+-------------+-----+-------------------+
+#
+# The coordinator owns slot 0, and sends a short beacon every frame.  Every other radio listens for
+# the beacon to find out when the frame started, and only transmits inside its own slot.
+# Data slots are sized from the time-on-air of the largest packet, plus a guard time.
+*/
+
+#define TDMA_COORDINATOR       0      //Slot number of the coordinator (the radio that sends beacons)
+#define TDMA_HEADER_LEN        2      //Bytes added to the front of every packet (packet type + slot number)
+#define TDMA_TX_LEAD_MICROS    25000  //How early we start loading a packet into the radio before its slot
+#define TDMA_DEFAULT_GUARD     1000   //Default spare time (us) at the end of each slot, for clock drift and timing jitter
+#define TDMA_SYNC_LOST_FRAMES  4      //Stop transmitting after missing this many beacons in a row
+
+class LoraTdma {
+  public:
+    bool begin(LoraSx1262* radio, int slotCount, int mySlot, int maxPayloadLen, uint32_t guardMicros = TDMA_DEFAULT_GUARD);
+    bool send(byte* data, int dataLen);     /*Queues a packet for our next slot. data must stay valid until sendPending() is false*/
+    bool sendPending();                     /*True while a queued packet is waiting for its slot*/
+    int poll(byte* buff, int buffMaxLen);   /*Call often.  Sends beacons and queued packets on time, and returns received packets*/
+    uint32_t idleMicros();                  /*How long poll() can be left alone, as long as DIO1 stays low*/
+    bool isSynced();                        /*True when we know where the frame starts (always true for the coordinator)*/
+
+    //Slot timing.  Calculated in begin() from the radio config, so call begin() again after changing the radio config
+    uint32_t slotMicros = 0;        //Length of a data slot
+    uint32_t beaconSlotMicros = 0;  //Length of slot 0
+    uint32_t frameMicros = 0;       //Length of a full frame
+
+    int lastSourceSlot = -1;        //Slot of whoever sent the last packet returned by poll()
+    uint32_t missedSlots = 0;       //How many times we were too late to make our own slot
+
+  private:
+    uint32_t slotOffset(int slot);
+    uint32_t nextSlotStart();
+    uint32_t frameDrift(uint32_t newFrameStart);
+    bool wantsToTransmit();
+    int receive(byte* buff, int buffMaxLen);
+
+    LoraSx1262* radio = NULL;
+    int slotCount = 0;
+    int mySlot = 0;
+    int maxPayloadLen = 0;
+    uint32_t guardMicros = 0;
+    uint32_t beaconAirMicros = 0;   //Time-on-air of a beacon
+
+    uint32_t frameStart = 0;        //micros() time the current frame started
+    bool synced = false;
+    uint32_t lastBeaconMicros = 0;
+
+    byte* pendingData = NULL;
+    int pendingLen = 0;
+    bool pending = false;
+};
+
+#endif